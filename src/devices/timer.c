@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include "lib/kernel/list.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
@@ -25,22 +27,89 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Time-stamp counter rate, in cycles per second, or 0 if the TSC
+   has not been calibrated yet.  Initialized by timer_calibrate(),
+   along with the TSC value and tick count of a common instant
+   that timer_now_ns() counts from. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t tsc_base_ticks;
+
+/* Number of TSC calibration ticks. */
+#define TSC_CALIBRATION_TICKS 10
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second at all times.
+   If true, the idle thread switches the PIT to one-shot mode
+   timed for the next timer event, so that idle ticks don't
+   cause interrupts.  The skipped ticks are added to `ticks'
+   when the CPU wakes up.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick. */
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Number of timer ticks that the pending one-shot PIT countdown
+   stands for, or 0 if the PIT is in periodic mode. */
+static int oneshot_ticks;
+
+/* PIT count loaded for the pending one-shot countdown. */
+static unsigned oneshot_count;
+
+/* Number of timer interrupts avoided by tickless idle. */
+static int64_t tickless_skipped;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
+static void calibrate_tsc (void);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
-struct list timer_waiting_list;
+/* Hierarchical timing wheel of sleeping threads.
+
+   Level 0 has one slot per tick for the next WHEEL_SLOTS ticks.
+   Each slot in level N covers WHEEL_SLOTS times as many ticks
+   as a slot in level N - 1.  A thread is put in the lowest level
+   whose range covers its wake-up time, so insertion and removal
+   are O(1).  Each tick, timer_wake_up() wakes every thread in
+   the current level 0 slot.  Each time the level 0 index wraps
+   to 0, the next slot of level 1 is "cascaded" by reinserting
+   its threads into level 0, and likewise up the levels, so every
+   thread is moved at most once per level.
+
+   Wake-ups further away than the top level can represent are
+   parked in its farthest slot and reinserted when it cascades. */
+#define WHEEL_BITS 6                            /* Bits per level. */
+#define WHEEL_SLOTS (1 << WHEEL_BITS)           /* Slots per level. */
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4                          /* Number of levels. */
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/* Next tick to be processed by timer_wake_up(). */
+static int64_t wheel_ticks;
+
+static void wheel_insert (struct thread *);
+static bool wheel_cascade (int level);
+static int64_t wheel_next_event (int64_t limit);
+static void timer_advance (int cnt);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  int level, slot;
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
-  list_init(&timer_waiting_list);
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SLOTS; slot++)
+      list_init (&wheel[level][slot]);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -68,6 +137,9 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  calibrate_tsc ();
+  printf ("TSC: %'"PRIu64" kHz.\n", tsc_hz / 1000);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -88,25 +160,112 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, as
+   measured by the time-stamp counter.  Before timer_calibrate()
+   has run, this has only tick resolution. */
+int64_t
+timer_now_ns (void) 
+{
+  if (tsc_hz == 0)
+    return timer_ticks () * NS_PER_TICK;
+  return (tsc_base_ticks * NS_PER_TICK
+          + timer_tsc_to_ns (timer_rdtsc () - tsc_base));
+}
+
+/* Returns the number of nanoseconds elapsed since THEN, which
+   should be a value once returned by timer_now_ns(). */
+int64_t
+timer_elapsed_ns (int64_t then) 
+{
+  return timer_now_ns () - then;
+}
+
+/* Returns the time-stamp counter frequency in Hz, or 0 if it has
+   not been calibrated yet. */
+uint64_t
+timer_tsc_hz (void) 
+{
+  return tsc_hz;
+}
+
+/* Converts TSC_DELTA time-stamp counter cycles to nanoseconds.
+   Converts whole seconds separately from the rest so that the
+   64-bit intermediate products cannot overflow. */
+int64_t
+timer_tsc_to_ns (uint64_t tsc_delta) 
+{
+  uint64_t secs, rest;
+
+  if (tsc_hz == 0)
+    return 0;
+  secs = tsc_delta / tsc_hz;
+  rest = tsc_delta % tsc_hz;
+  return secs * 1000 * 1000 * 1000 + rest * 1000 * 1000 * 1000 / tsc_hz;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
 timer_sleep (int64_t ticks) 
 {
   int64_t start = timer_ticks();
-  int64_t end = start + ticks;
-
-  enum intr_level prev_intr_stat = intr_disable();
-  struct thread *cur_thread = thread_current();
+  enum intr_level prev_intr_stat;
+  struct thread *cur_thread;
 
-  cur_thread->time_to_wake_up = end;
-  list_insert_ordered(&timer_waiting_list, &cur_thread->elem, thread_wake_up_tick_is_smaller, NULL);
+  ASSERT (intr_get_level () == INTR_ON);
+  if (ticks <= 0)
+    return;
 
+  prev_intr_stat = intr_disable();
+  cur_thread = thread_current();
+  cur_thread->time_to_wake_up = start + ticks;
+  wheel_insert (cur_thread);
   thread_block();
 
   intr_set_level(prev_intr_stat);
 }
 
+/* Arranges for the current thread, which is about to block on
+   some wait queue, to be unblocked after about TICKS timer ticks
+   unless timer_cancel() is called first.  TICKS must be
+   positive.  Interrupts must be off, and the caller should call
+   thread_block() before turning them back on. */
+void
+timer_set_timeout (int64_t ticks)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (ticks > 0);
+
+  cur->time_to_wake_up = timer_ticks () + ticks;
+  wheel_insert (cur);
+}
+
+/* Cancels the pending timer_sleep() wake-up of thread T, which
+   must be blocked.  Returns true if T was sleeping, false if it
+   was not (for example, because it already woke up).
+
+   This does not unblock T.  A caller that wants to wake a
+   sleeper early, or that blocked T with a timeout on some other
+   wait queue, should call thread_unblock() itself when this
+   returns true.  May be called from an interrupt handler. */
+bool
+timer_cancel (struct thread *t)
+{
+  enum intr_level old_level = intr_disable ();
+  bool pending = t->time_to_wake_up != 0;
+
+  if (pending)
+    {
+      list_remove (&t->timer_elem);
+      t->time_to_wake_up = 0;
+    }
+  intr_set_level (old_level);
+
+  return pending;
+}
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -139,19 +298,34 @@ timer_nsleep (int64_t ns)
    will cause timer ticks to be lost.  Thus, use timer_msleep()
    instead if interrupts are enabled. */
 
+
+/* Wakes up the sleeping threads whose time has come.  Called
+   from the timer interrupt after ticks advances. */
 void
 timer_wake_up (void)
 {
-  struct thread *cur_thread;
-  while(!list_empty(&timer_waiting_list)){
-    cur_thread = list_entry(list_front(&timer_waiting_list), struct thread, elem);
-    if(ticks >= cur_thread->time_to_wake_up){
-      list_pop_front(&timer_waiting_list);
-      thread_unblock(cur_thread);
-    } else {
-      break;
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_ticks <= ticks)
+    {
+      struct list *slot;
+      int level;
+
+      for (level = 1; level < WHEEL_LEVELS; level++)
+        if (!wheel_cascade (level))
+          break;
+
+      slot = &wheel[0][wheel_ticks & WHEEL_MASK];
+      while (!list_empty (slot))
+        {
+          struct thread *t = list_entry (list_pop_front (slot),
+                                         struct thread, timer_elem);
+          ASSERT (t->time_to_wake_up == wheel_ticks);
+          t->time_to_wake_up = 0;
+          thread_unblock (t);
+        }
+      wheel_ticks++;
     }
-  }
 }
 
 void
@@ -191,15 +365,220 @@ void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" interrupts skipped by tickless idle\n",
+            tickless_skipped);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick
+   by a one-shot countdown to the next tick at which there is
+   timer work to do, an EDF thread to release, or delayed work to
+   queue, keeping the phase of the periodic tick.  The 16-bit PIT
+   counter limits this to about 5 ticks at 100 Hz. */
+void
+timer_idle_enter (void)
+{
+  unsigned remaining;
+  int64_t deadline, release;
+  int cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0 || intr_is_pending (0x20))
+    return;
+
+  /* REMAINING is the number of PIT cycles until the next
+     periodic tick. */
+  remaining = pit_read_count (0);
+  deadline = wheel_next_event (ticks + 1
+                               + (65536 - remaining) / PIT_COUNTS_PER_TICK);
+  release = thread_edf_next_release ();
+  if (release < deadline)
+    deadline = release;
+  release = workqueue_next_expiry ();
+  if (release < deadline)
+    deadline = release;
+  cnt = deadline - ticks;
+  if (cnt < 2)
+    return;
+
+  oneshot_ticks = cnt;
+  oneshot_count = remaining + (cnt - 1) * PIT_COUNTS_PER_TICK;
+  pit_configure_oneshot (0, oneshot_count);
+  tickless_skipped += cnt - 1;
+}
+
+/* Called by the idle thread, with interrupts off, after an
+   interrupt has woken it.  If that interrupt was not the end of
+   the one-shot countdown, accounts for the ticks that have
+   passed so far and times the countdown to end at the next tick
+   boundary, where timer_interrupt() resumes periodic mode. */
+void
+timer_idle_exit (void)
+{
+  unsigned count, elapsed, first;
+  int cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0)
+    return;
+
+  /* Read the counter before checking for the interrupt.  If the
+     countdown ends in between, the interrupt is then pending.
+     Once the countdown ends, the counter wraps around and counts
+     down from 65536, so a count above ONESHOT_COUNT also means it
+     ran out. */
+  count = pit_read_count (0);
+  if (intr_is_pending (0x20) || count > oneshot_count)
+    {
+      /* The countdown ran out.  Its interrupt will account for
+         the last tick. */
+      cnt = oneshot_ticks - 1;
+    }
+  else
+    {
+      elapsed = oneshot_count - count;
+      first = oneshot_count - (oneshot_ticks - 1) * PIT_COUNTS_PER_TICK;
+      cnt = elapsed < first ? 0 : 1 + (elapsed - first) / PIT_COUNTS_PER_TICK;
+      tickless_skipped -= oneshot_ticks - 1 - cnt;
+      oneshot_count = first + cnt * PIT_COUNTS_PER_TICK - elapsed;
+      pit_configure_oneshot (0, oneshot_count);
+    }
+  oneshot_ticks = 1;
+
+  ticks += cnt;
+  timer_wake_up ();
+  thread_account_idle (cnt);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
+{
+  int cnt = 1;
+
+  profile_sample (args);
+
+  if (oneshot_ticks != 0)
+    {
+      /* End of a one-shot countdown.  Go back to periodic mode
+         and account for all the ticks the countdown covered. */
+      cnt = oneshot_ticks;
+      oneshot_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+  timer_advance (cnt);
+}
+
+/* Advances the clock by CNT ticks, waking sleepers and running
+   the scheduler's per-tick work for each. */
+static void
+timer_advance (int cnt)
+{
+  while (cnt-- > 0)
+    {
+      ticks++;
+      timer_wake_up();
+      workqueue_tick (ticks);
+      thread_tick ();
+    }
+}
+
+/* Adds sleeping thread T to the timing wheel slot for its
+   time_to_wake_up.  A wake-up time that has already been
+   processed is moved up to the next unprocessed tick. */
+static void
+wheel_insert (struct thread *t)
+{
+  int64_t expires, delta;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->time_to_wake_up < wheel_ticks)
+    t->time_to_wake_up = wheel_ticks;
+  expires = t->time_to_wake_up;
+  delta = expires - wheel_ticks;
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      break;
+  if (delta >= (int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+    expires = wheel_ticks + ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+
+  list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level))
+                                & WHEEL_MASK],
+                  &t->timer_elem);
+}
+
+/* Returns the first tick before LIMIT at which timer_wake_up()
+   has work to do: a level 0 slot with sleepers or a cascade.
+   Under the MLFQS scheduler, the once-a-second recomputation in
+   thread_tick() also counts.  Returns LIMIT if there is none. */
+static int64_t
+wheel_next_event (int64_t limit)
+{
+  int64_t t;
+
+  for (t = wheel_ticks; t < limit; t++)
+    if ((t & WHEEL_MASK) == 0
+        || !list_empty (&wheel[0][t & WHEEL_MASK])
+        || (thread_mlfqs && t % TIMER_FREQ == 0))
+      return t;
+  return limit;
+}
+
+/* If wheel_ticks is at a slot boundary of LEVEL, reinserts the
+   threads in LEVEL's current slot into lower levels and returns
+   true.  Otherwise returns false, and no higher level is at a
+   slot boundary either. */
+static bool
+wheel_cascade (int level)
+{
+  int64_t units = wheel_ticks >> (WHEEL_BITS * (level - 1));
+  struct list *slot;
+  struct list moving;
+
+  if ((units & WHEEL_MASK) != 0)
+    return false;
+
+  slot = &wheel[level][(units >> WHEEL_BITS) & WHEEL_MASK];
+  list_init (&moving);
+  while (!list_empty (slot))
+    list_push_back (&moving, list_pop_front (slot));
+  while (!list_empty (&moving))
+    wheel_insert (list_entry (list_pop_front (&moving),
+                              struct thread, timer_elem));
+  return true;
+}
+
+/* Measures tsc_hz by counting time-stamp counter cycles across
+   TSC_CALIBRATION_TICKS timer ticks, starting and ending right
+   at tick boundaries. */
+static void
+calibrate_tsc (void) 
 {
-  ticks++;
-  timer_wake_up();
-  thread_tick ();
+  int64_t start;
+  uint64_t start_tsc, end_tsc;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  start = ticks;
+  start_tsc = timer_rdtsc ();
+  while (ticks < start + TSC_CALIBRATION_TICKS)
+    barrier ();
+  end_tsc = timer_rdtsc ();
+
+  tsc_base = start_tsc;
+  tsc_base_ticks = start;
+  tsc_hz = (end_tsc - start_tsc) * TIMER_FREQ / TSC_CALIBRATION_TICKS;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -248,7 +627,34 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (tsc_hz != 0)
+    {
+      /* Block until the last tick boundary before the deadline,
+         if there is one, then spin on the TSC for the remainder,
+         which is less than a tick.  The PIT's count is the time
+         left until the next boundary.  Read it and the tick count
+         with interrupts off, so that they agree. */
+      int64_t deadline = timer_now_ns () + num * (1000 * 1000 * 1000 / denom);
+      enum intr_level old_level = intr_disable ();
+      int64_t next_tick_ns = (timer_now_ns ()
+                              + (int64_t) pit_read_count (0)
+                                * (1000 * 1000 * 1000) / PIT_HZ);
+
+      if (next_tick_ns <= deadline)
+        {
+          struct thread *cur = thread_current ();
+
+          cur->time_to_wake_up = (timer_ticks () + 1
+                                  + (deadline - next_tick_ns) / NS_PER_TICK);
+          wheel_insert (cur);
+          thread_block ();
+        }
+      intr_set_level (old_level);
+
+      while (timer_now_ns () < deadline)
+        barrier ();
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
@@ -2,17 +2,40 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+struct thread;
+
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* If true, stop the periodic tick while idle.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* High-resolution time, from the CPU's time-stamp counter. */
+int64_t timer_now_ns (void);
+int64_t timer_elapsed_ns (int64_t);
+int64_t timer_tsc_to_ns (uint64_t tsc_delta);
+uint64_t timer_tsc_hz (void);
+
+/* Returns the CPU's time-stamp counter.
+   See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+timer_rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -21,6 +44,12 @@ void timer_nsleep (int64_t nanoseconds);
 
 /* Wake up threads which time_to_wake_up is smaller then current time */
 void timer_wake_up (void);
+bool timer_cancel (struct thread *);
+void timer_set_timeout (int64_t ticks);
+
+/* Tickless idle, called by the idle thread. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
 
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
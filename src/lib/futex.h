@@ -0,0 +1,13 @@
+#ifndef __LIB_FUTEX_H
+#define __LIB_FUTEX_H
+
+/* Results of the futex_wait() system call.  Shared between the
+   kernel and user programs, like syscall-nr.h. */
+#define FUTEX_WOKEN 0           /* Woken by futex_wake(). */
+#define FUTEX_AGAIN 1           /* *ADDR was not EXPECTED. */
+#define FUTEX_TIMEDOUT 2        /* Timeout expired first. */
+
+/* futex_wait() timeout that never expires. */
+#define FUTEX_FOREVER (-1)
+
+#endif /* lib/futex.h */
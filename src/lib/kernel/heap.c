@@ -0,0 +1,207 @@
+/* Priority queue.
+
+   See heap.h for basic information.  The pairing heap is
+   described in M. L. Fredman, R. Sedgewick, D. D. Sleator, and
+   R. E. Tarjan, "The Pairing Heap: A New Form of Self-Adjusting
+   Heap", Algorithmica 1 (1986). */
+
+#include "heap.h"
+#include "../debug.h"
+
+static bool precedes (const struct heap *,
+                      const struct heap_elem *, const struct heap_elem *);
+static struct heap_elem *meld (const struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (const struct heap *,
+                                      struct heap_elem *);
+static void link_elem (struct heap *, struct heap_elem *);
+static void unlink_elem (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap that orders its elements using
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->next_seq = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->seq = h->next_seq++;
+  link_elem (h, e);
+}
+
+/* Returns the greatest element in H, without removing it.
+   Undefined behavior if H is empty. */
+struct heap_elem *
+heap_top (const struct heap *h)
+{
+  ASSERT (!heap_empty (h));
+
+  return h->root;
+}
+
+/* Removes and returns the greatest element in H.  Undefined
+   behavior if H is empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top = heap_top (h);
+
+  unlink_elem (h, top);
+  return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (!heap_empty (h));
+  ASSERT (e != NULL);
+
+  unlink_elem (h, e);
+}
+
+/* Restores the heap order of H after the value of its element E
+   changed.  E keeps its place among elements that compare equal
+   to it. */
+void
+heap_update (struct heap *h, struct heap_elem *e)
+{
+  unlink_elem (h, e);
+  link_elem (h, e);
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  return h->root == NULL;
+}
+
+/* Returns true if A must come out of H before B: if A is greater
+   than B, or equal to B but inserted earlier.  The sequence
+   numbers are compared by difference so that wraparound is
+   harmless. */
+static bool
+precedes (const struct heap *h,
+          const struct heap_elem *a, const struct heap_elem *b)
+{
+  if (h->less (b, a, h->aux))
+    return true;
+  if (h->less (a, b, h->aux))
+    return false;
+  return (int) (a->seq - b->seq) < 0;
+}
+
+/* Melds the trees rooted at A and B, which must not have
+   siblings, into one and returns its root. */
+static struct heap_elem *
+meld (const struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  if (precedes (h, b, a))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the sibling trees starting at FIRST into a single tree
+   and returns its root, or a null pointer if FIRST is null.
+   Uses the standard two-pass method: meld the siblings in pairs
+   from left to right, then meld the pairs from right to left. */
+static struct heap_elem *
+merge_pairs (const struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;       /* Melded pairs, last first. */
+  struct heap_elem *root = NULL;
+
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = first->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          a = meld (h, a, b);
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = root != NULL ? meld (h, root, pairs) : pairs;
+      pairs = next;
+    }
+  return root;
+}
+
+/* Adds E, whose sequence number is already set, to H. */
+static void
+link_elem (struct heap *h, struct heap_elem *e)
+{
+  e->child = e->next = e->prev = NULL;
+  h->root = h->root != NULL ? meld (h, h->root, e) : e;
+  h->elem_cnt++;
+}
+
+/* Removes E from H: cuts E out of its sibling list, then melds
+   E's children back into the heap. */
+static void
+unlink_elem (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *children = merge_pairs (h, e->child);
+
+  if (e == h->root)
+    h->root = children;
+  else
+    {
+      /* E's predecessor is either its parent, if E is the first
+         child, or its previous sibling. */
+      if (e->prev->child == e)
+        e->prev->child = e->next;
+      else
+        e->prev->next = e->next;
+      if (e->next != NULL)
+        e->next->prev = e->prev;
+      if (children != NULL)
+        h->root = meld (h, h->root, children);
+    }
+  e->child = e->next = e->prev = NULL;
+  h->elem_cnt--;
+}
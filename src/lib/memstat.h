@@ -0,0 +1,52 @@
+#ifndef __LIB_MEMSTAT_H
+#define __LIB_MEMSTAT_H
+
+/* Kernel memory statistics, as returned by the memstat() system
+   call and printed at shutdown.  Shared between the kernel and
+   user programs, like syscall-nr.h.
+
+   The counts are gathered from each allocator in turn, without
+   stopping the others, so they are only approximately consistent
+   with one another. */
+
+/* Number of malloc() size classes, 16 bytes through 1 kB. */
+#define MEMSTAT_CLASSES 7
+
+/* A page allocator pool.  Sizes are in pages. */
+struct memstat_pool
+  {
+    unsigned pages;             /* Pages in the pool. */
+    unsigned used;              /* Pages allocated now. */
+    unsigned used_max;          /* Most pages ever allocated at once. */
+    unsigned free;              /* Pages on the free lists. */
+    unsigned zeroed;            /* Pages kept or being zeroed. */
+  };
+
+/* A malloc() size class. */
+struct memstat_class
+  {
+    unsigned block_size;        /* Bytes per block. */
+    unsigned arenas;            /* Pages divided into blocks. */
+    unsigned used;              /* Blocks allocated now. */
+    unsigned cached;            /* Free blocks in threads' magazines. */
+    unsigned free;              /* Free blocks on the free list. */
+    long long allocs;           /* Blocks ever allocated. */
+    long long requested;        /* Bytes requested for them. */
+    long long waste;            /* Estimated bytes of used blocks
+                                   beyond what was requested. */
+  };
+
+/* Memory statistics. */
+struct memstat
+  {
+    struct memstat_pool kernel_pool;    /* Kernel page pool. */
+    struct memstat_pool user_pool;      /* User page pool. */
+    struct memstat_class classes[MEMSTAT_CLASSES]; /* malloc() blocks. */
+    unsigned big_blocks;        /* malloc() blocks of whole pages now. */
+    unsigned big_pages;         /* Pages they take. */
+    long long big_allocs;       /* Such blocks ever allocated. */
+    unsigned frames;            /* Frame table entries now. */
+    unsigned frames_max;        /* Most frame table entries at once. */
+  };
+
+#endif /* lib/memstat.h */
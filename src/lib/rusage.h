@@ -0,0 +1,20 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+/* Resource usage of a thread or process, as returned by the
+   getrusage() system call.  Times are in timer ticks.  Shared
+   between the kernel and user programs, like syscall-nr.h. */
+struct rusage
+  {
+    long long user_ticks;       /* Ticks running a user program. */
+    long long kernel_ticks;     /* Ticks running in the kernel. */
+    long long voluntary_switches;   /* Switches away by blocking. */
+    long long involuntary_switches; /* Switches away by preemption. */
+    long long page_faults;      /* Page faults taken. */
+  };
+
+/* Whose usage getrusage() reports. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN 1       /* Its children that have been waited for. */
+
+#endif /* lib/rusage.h */
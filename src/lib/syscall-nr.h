@@ -28,7 +28,13 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_GETRUSAGE,              /* Obtain resource usage. */
+    SYS_FUTEX_WAIT,             /* Wait for a change at an address. */
+    SYS_FUTEX_WAKE,             /* Wake threads waiting at an address. */
+    SYS_MEMSTAT                 /* Obtain kernel memory statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
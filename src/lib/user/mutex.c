@@ -0,0 +1,85 @@
+#include <mutex.h>
+#include <syscall.h>
+
+/* The mutex is an int in one of three states: unlocked (0),
+   locked with no waiters (1), or locked with possible waiters
+   (2).  Unlocking from state 1 needs no system call, and a
+   thread that finds the mutex locked moves it to state 2 before
+   sleeping, so that the unlocker knows to wake it.  See U.
+   Drepper, "Futexes Are Tricky" (2011), mutex "take 2". */
+
+/* If *P equals OLD, atomically stores NEW into *P.  Returns the
+   value *P had.  See [IA32-v2a] "CMPXCHG". */
+static inline int
+compare_exchange (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically stores NEW into *P and returns its old value.  See
+   [IA32-v2b] "XCHG". */
+static inline int
+exchange (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically decrements *P and returns its old value.  See
+   [IA32-v2b] "XADD". */
+static inline int
+fetch_and_decrement (int *p)
+{
+  int old = -1;
+  asm volatile ("lock xaddl %0, %1" : "+r" (old), "+m" (*p) : : "memory");
+  return old;
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m)
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping until it is available if necessary. */
+void
+mutex_lock (struct mutex *m)
+{
+  int c = compare_exchange (&m->state, 0, 1);
+
+  if (c == 0)
+    return;
+  if (c != 2)
+    c = exchange (&m->state, 2);
+  while (c != 0)
+    {
+      futex_wait (&m->state, 2, FUTEX_FOREVER);
+      c = exchange (&m->state, 2);
+    }
+}
+
+/* Tries to acquire M without sleeping.  Returns true if
+   successful, false if M is already locked. */
+bool
+mutex_trylock (struct mutex *m)
+{
+  return compare_exchange (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the caller must hold, and wakes a waiter if
+   there may be one. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (fetch_and_decrement (&m->state) != 1)
+    {
+      m->state = 0;
+      futex_wake (&m->state, 1);
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef __LIB_USER_MUTEX_H
+#define __LIB_USER_MUTEX_H
+
+#include <stdbool.h>
+
+/* Mutual exclusion lock for user programs, built on the futex
+   system calls.  Locking and unlocking a mutex that no other
+   thread wants stays in user space.  To share a mutex between
+   processes, put it in memory that both map. */
+struct mutex
+  {
+    int state;          /* 0: unlocked, 1: locked, 2: locked with waiters. */
+  };
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+#endif /* lib/user/mutex.h */
@@ -183,3 +183,27 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+getrusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
+
+bool
+memstat (struct memstat *stat)
+{
+  return syscall1 (SYS_MEMSTAT, stat);
+}
+
+int
+futex_wait (int *addr, int expected, int timeout_ms)
+{
+  return syscall3 (SYS_FUTEX_WAIT, addr, expected, timeout_ms);
+}
+
+int
+futex_wake (int *addr, int cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <futex.h>
+#include <memstat.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,10 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool getrusage (int who, struct rusage *);
+int futex_wait (int *addr, int expected, int timeout_ms);
+int futex_wake (int *addr, int cnt);
+bool memstat (struct memstat *);
+
 #endif /* lib/user/syscall.h */
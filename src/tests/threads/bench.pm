@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks the output of a benchmark that reports each of
+# @MEASUREMENTS as a line "(TEST) MEASUREMENT: N ns".  The
+# timings vary from run to run, so only checks that every
+# measurement was reported.  Returns the core output, for any
+# further checks.
+sub check_bench {
+    my (@measurements) = @_;
+    our ($test);
+    my ($name) = $test =~ m%([^/]+)$%;
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    foreach my $what (@measurements) {
+	fail "missing \"$what\" measurement\n"
+	  if !grep (/^\(\Q$name\E\) \Q$what\E: \d+ ns$/, @output);
+    }
+    return @output;
+}
+
+1;
@@ -0,0 +1,96 @@
+/* Checks admission control and preemption in the
+   earliest-deadline-first class.
+
+   Two EDF threads that together reserve 90% of the CPU are
+   admitted, and a third that would push the total over 100% is
+   rejected.  The admitted threads run 5 jobs each while a
+   CPU-bound thread at PRI_MAX spins, so they only meet their
+   deadlines if EDF threads preempt the normal classes.  Once
+   they exit, their reservation is released and the third thread
+   is admitted. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 5
+
+struct edf_info 
+  {
+    int64_t work;                       /* Ticks to spin per job. */
+    unsigned misses;                    /* Deadline misses seen. */
+    struct semaphore *done;             /* Upped on exit. */
+  };
+
+static thread_func edf_thread;
+static thread_func hog_thread;
+static volatile int edf_finished;
+
+void
+test_edf_admit (void) 
+{
+  struct semaphore done;
+  struct edf_info a, b, c;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  a.work = b.work = c.work = 2;
+  a.misses = b.misses = c.misses = 0;
+  a.done = b.done = c.done = &done;
+
+  /* 5/10 + 6/15 = 0.9, then 2/10 more is too much. */
+  if (thread_create_edf ("edf a", 10, 5, 10, edf_thread, &a) == TID_ERROR)
+    fail ("thread a with density 0.5 rejected");
+  if (thread_create_edf ("edf b", 20, 6, 15, edf_thread, &b) == TID_ERROR)
+    fail ("thread b with density 0.4 rejected");
+  if (thread_create_edf ("edf c", 10, 2, 10, edf_thread, &c) != TID_ERROR)
+    fail ("thread c with density 0.2 admitted at total 1.1");
+  msg ("Admitted a and b, rejected c.");
+
+  /* The hog keeps us off the CPU until A and B finish. */
+  thread_create ("hog", PRI_MAX, hog_thread, NULL);
+  for (i = 0; i < 2; i++)
+    sema_down (&done);
+  msg ("Thread a missed %u deadlines.", a.misses);
+  msg ("Thread b missed %u deadlines.", b.misses);
+
+  /* A and B have exited, so C fits now. */
+  if (thread_create_edf ("edf c", 10, 2, 10, edf_thread, &c) == TID_ERROR)
+    fail ("thread c rejected after a and b exited");
+  sema_down (&done);
+  msg ("Admitted c after a and b exited.");
+}
+
+/* Runs JOB_CNT jobs of INFO_->work ticks each, then records the
+   thread's deadline misses. */
+static void
+edf_thread (void *info_) 
+{
+  struct edf_info *info = info_;
+  int i;
+
+  for (i = 0; i < JOB_CNT; i++) 
+    {
+      int64_t start = timer_ticks ();
+      while (timer_elapsed (start) < info->work)
+        continue;
+      thread_edf_wait ();
+    }
+  info->misses = thread_get_deadline_misses ();
+  edf_finished++;
+  sema_up (info->done);
+}
+
+/* Spins at PRI_MAX until EDF threads A and B are done. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (edf_finished < 2)
+    continue;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) Admitted a and b, rejected c.
+(edf-admit) Thread a missed 0 deadlines.
+(edf-admit) Thread b missed 0 deadlines.
+(edf-admit) Admitted c after a and b exited.
+(edf-admit) end
+EOF
+pass;
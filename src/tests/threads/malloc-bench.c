@@ -0,0 +1,224 @@
+/* Measures malloc() and free() throughput, then checks that
+   the per-thread magazines hand out blocks correctly.
+
+   For each block size, times three patterns:
+
+   - "pair": malloc() of one block immediately followed by its
+     free(), the common case for short-lived buffers.
+
+   - "batch": BATCH malloc() calls followed by BATCH free()
+     calls, which runs through magazines faster than they hold
+     blocks and so also exercises refilling and draining them.
+
+   - "threads": THREAD_CNT threads doing pairs at the same time,
+     preempting one another.
+
+   Each result is the average time per malloc() and free() pair,
+   taken from the fastest of REPS runs.
+
+   Afterward, checks that a block just freed is the next one
+   malloc() returns for its size, because it is on top of the
+   thread's magazine, and that BATCH blocks allocated once the
+   other threads have exited and drained their magazines are
+   distinct and keep their contents. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 1000
+#define BATCH 64
+#define THREAD_CNT 4
+#define REPS 5
+
+static int64_t time_pairs (size_t size);
+static int64_t time_batch (size_t size);
+static int64_t time_threads (size_t size);
+static thread_func pair_thread;
+static void check_reuse (size_t size);
+static void check_distinct (size_t size);
+
+/* Block size for pair_thread(), and its completion signal. */
+static size_t thread_size;
+static struct semaphore thread_done;
+
+void
+test_malloc_bench (void)
+{
+  static const size_t sizes[] = {16, 64, 256, 1024, 4096};
+  size_t i;
+
+  sema_init (&thread_done, 0);
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      msg ("pair of %zu bytes: %"PRId64" ns",
+           sizes[i], time_pairs (sizes[i]));
+      msg ("batch of %zu bytes: %"PRId64" ns",
+           sizes[i], time_batch (sizes[i]));
+      msg ("threads of %zu bytes: %"PRId64" ns",
+           sizes[i], time_threads (sizes[i]));
+    }
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      /* Big blocks come straight from the page allocator, which
+         makes no promise about reuse. */
+      if (sizes[i] <= 1024)
+        check_reuse (sizes[i]);
+      check_distinct (sizes[i]);
+    }
+}
+
+/* Checks that malloc() of SIZE bytes returns the block of that
+   size that was freed last. */
+static void
+check_reuse (size_t size)
+{
+  void *p = malloc (size);
+  uintptr_t freed = (uintptr_t) p;
+
+  if (p == NULL)
+    fail ("malloc (%zu) failed", size);
+  free (p);
+  p = malloc (size);
+  if ((uintptr_t) p != freed)
+    fail ("malloc (%zu) did not return the block just freed", size);
+  free (p);
+  msg ("freed block of %zu bytes reused", size);
+}
+
+/* Checks that BATCH blocks of SIZE bytes allocated at once do
+   not overlap, by filling each with a different byte and then
+   checking that every block still holds its own byte. */
+static void
+check_distinct (size_t size)
+{
+  unsigned char *blocks[BATCH];
+  size_t i, j;
+
+  for (i = 0; i < BATCH; i++)
+    {
+      blocks[i] = malloc (size);
+      if (blocks[i] == NULL)
+        fail ("malloc (%zu) failed", size);
+      memset (blocks[i], i, size);
+    }
+  for (i = 0; i < BATCH; i++)
+    for (j = 0; j < size; j++)
+      if (blocks[i][j] != i)
+        fail ("block %zu of %zu bytes overwritten at offset %zu",
+              i, size, j);
+  for (i = 0; i < BATCH; i++)
+    free (blocks[i]);
+  msg ("%zu-byte blocks distinct", size);
+}
+
+/* Returns the shortest average time, in nanoseconds, observed
+   for a malloc() of SIZE bytes immediately freed. */
+static int64_t
+time_pairs (size_t size)
+{
+  uint64_t best = UINT64_MAX;
+  int rep, i;
+
+  for (rep = 0; rep < REPS; rep++)
+    {
+      uint64_t start = timer_rdtsc ();
+      uint64_t elapsed;
+
+      for (i = 0; i < ITERATIONS; i++)
+        {
+          void *p = malloc (size);
+          if (p == NULL)
+            fail ("malloc (%zu) failed", size);
+          free (p);
+        }
+      elapsed = timer_rdtsc () - start;
+      if (elapsed < best)
+        best = elapsed;
+    }
+  return timer_tsc_to_ns (best) / ITERATIONS;
+}
+
+/* Returns the shortest average time, in nanoseconds, observed
+   per block for BATCH malloc() calls of SIZE bytes followed by
+   freeing all of them. */
+static int64_t
+time_batch (size_t size)
+{
+  void *blocks[BATCH];
+  uint64_t best = UINT64_MAX;
+  int rep, i, j;
+
+  for (rep = 0; rep < REPS; rep++)
+    {
+      uint64_t start = timer_rdtsc ();
+      uint64_t elapsed;
+
+      for (i = 0; i < ITERATIONS / BATCH; i++)
+        {
+          for (j = 0; j < BATCH; j++)
+            {
+              blocks[j] = malloc (size);
+              if (blocks[j] == NULL)
+                fail ("malloc (%zu) failed", size);
+            }
+          for (j = 0; j < BATCH; j++)
+            free (blocks[j]);
+        }
+      elapsed = timer_rdtsc () - start;
+      if (elapsed < best)
+        best = elapsed;
+    }
+  return timer_tsc_to_ns (best) / (ITERATIONS / BATCH * BATCH);
+}
+
+/* Returns the shortest average time, in nanoseconds, observed
+   per malloc() and free() pair of SIZE bytes across THREAD_CNT
+   threads running at once. */
+static int64_t
+time_threads (size_t size)
+{
+  uint64_t best = UINT64_MAX;
+  int rep, i;
+
+  thread_size = size;
+  for (rep = 0; rep < REPS; rep++)
+    {
+      uint64_t start = timer_rdtsc ();
+      uint64_t elapsed;
+
+      /* The threads run at our priority, so they start when we
+         block waiting for them. */
+      for (i = 0; i < THREAD_CNT; i++)
+        thread_create ("pairs", PRI_DEFAULT, pair_thread, NULL);
+      for (i = 0; i < THREAD_CNT; i++)
+        sema_down (&thread_done);
+      elapsed = timer_rdtsc () - start;
+      if (elapsed < best)
+        best = elapsed;
+    }
+  return timer_tsc_to_ns (best) / (ITERATIONS * THREAD_CNT);
+}
+
+/* Does ITERATIONS malloc() and free() pairs of thread_size
+   bytes, then signals thread_done. */
+static void
+pair_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      void *p = malloc (thread_size);
+      if (p == NULL)
+        fail ("malloc (%zu) failed", thread_size);
+      free (p);
+    }
+  sema_up (&thread_done);
+}
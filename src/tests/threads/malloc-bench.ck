@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+my (@measurements);
+foreach my $size (16, 64, 256, 1024, 4096) {
+    push (@measurements,
+	  map ("$_ of $size bytes", 'pair', 'batch', 'threads'));
+}
+my (@output) = check_bench (@measurements);
+
+foreach my $size (16, 64, 256, 1024) {
+    fail "no check that freed blocks of $size bytes are reused\n"
+      if !grep (/^\(malloc-bench\) freed block of $size bytes reused$/,
+		@output);
+}
+foreach my $size (16, 64, 256, 1024, 4096) {
+    fail "no check that blocks of $size bytes are distinct\n"
+      if !grep (/^\(malloc-bench\) $size-byte blocks distinct$/, @output);
+}
+pass;
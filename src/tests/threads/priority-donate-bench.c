@@ -0,0 +1,178 @@
+/* Measures how long priority donation keeps interrupts off.
+
+   For each chain depth D, the main thread drops to PRI_MIN and
+   acquires lock 0, then creates helper threads 1...D-1, each of
+   which acquires lock i and blocks on lock i-1, donating its
+   priority down the chain to the main thread.  Then a donor
+   thread at PRI_DEFAULT reads the time-stamp counter and blocks
+   on lock D-1, which makes lock_acquire() donate along all D
+   links of the chain.  The main thread, now the highest-priority
+   ready thread, reads the time-stamp counter as soon as it runs
+   again.  Interrupts stay off the whole time in between, so the
+   difference is one interrupts-off window of lock_acquire(): the
+   donation itself plus the switch to the main thread.
+
+   Afterward, the main thread times lock_release() of a lock
+   while holding H other locks, each with a waiter, which is the
+   interrupts-off window of recomputing its donated priority.
+
+   The minimum over several repetitions is reported, to filter
+   out timer interrupts and emulator noise.  There are no pass or
+   fail criteria beyond completing; compare the numbers across
+   kernels. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_DEPTH 8
+#define MAX_HELD 16
+#define REPS 10
+
+static struct lock locks[MAX_HELD + 1];
+static uint64_t donate_start;
+
+struct chain_link
+  {
+    struct lock *own;                   /* Lock to hold, or null. */
+    struct lock *wait;                  /* Lock to wait for. */
+  };
+
+static thread_func chain_thread;
+static thread_func donor_thread;
+static int64_t time_donation (int depth);
+static int64_t time_release (int held);
+
+void
+test_priority_donate_bench (void)
+{
+  static const int depths[] = {1, 2, 4, 8};
+  static const int helds[] = {0, 4, 16};
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < sizeof depths / sizeof *depths; i++)
+    msg ("donation through %d locks: %"PRId64" ns",
+         depths[i], time_donation (depths[i]));
+  for (i = 0; i < sizeof helds / sizeof *helds; i++)
+    msg ("release holding %d other locks: %"PRId64" ns",
+         helds[i], time_release (helds[i]));
+}
+
+/* Returns the shortest time, in nanoseconds, observed for a
+   donation through a chain of DEPTH locks. */
+static int64_t
+time_donation (int depth)
+{
+  struct chain_link links[MAX_DEPTH];
+  uint64_t best = UINT64_MAX;
+  int rep, i;
+
+  ASSERT (depth >= 1 && depth <= MAX_DEPTH);
+
+  for (rep = 0; rep < REPS; rep++)
+    {
+      uint64_t end;
+
+      thread_set_priority (PRI_MIN);
+      for (i = 0; i < depth; i++)
+        lock_init (&locks[i]);
+      lock_acquire (&locks[0]);
+
+      for (i = 1; i < depth; i++)
+        {
+          links[i].own = &locks[i];
+          links[i].wait = &locks[i - 1];
+          thread_create ("chain", PRI_MIN + i, chain_thread, &links[i]);
+        }
+
+      /* The donor preempts us, blocks, and donates back to us. */
+      thread_create ("donor", PRI_DEFAULT, donor_thread, &locks[depth - 1]);
+      end = timer_rdtsc ();
+      if (thread_get_priority () != PRI_DEFAULT)
+        fail ("main has priority %d after donation, expected %d",
+              thread_get_priority (), PRI_DEFAULT);
+      if (end - donate_start < best)
+        best = end - donate_start;
+
+      /* Let the chain unwind; every other thread outranks us. */
+      lock_release (&locks[0]);
+    }
+  thread_set_priority (PRI_DEFAULT);
+  return timer_tsc_to_ns (best);
+}
+
+/* Returns the shortest time, in nanoseconds, observed for
+   releasing a lock while holding HELD other locks that each have
+   a waiter. */
+static int64_t
+time_release (int held)
+{
+  struct chain_link links[MAX_HELD];
+  uint64_t best = UINT64_MAX;
+  int rep, i;
+
+  ASSERT (held >= 0 && held <= MAX_HELD);
+
+  for (rep = 0; rep < REPS; rep++)
+    {
+      uint64_t start, end;
+
+      thread_set_priority (PRI_MIN);
+      for (i = 0; i <= held; i++)
+        lock_init (&locks[i]);
+      for (i = 0; i <= held; i++)
+        lock_acquire (&locks[i]);
+
+      /* Give each of the other locks a waiter that donates to us. */
+      for (i = 0; i < held; i++)
+        {
+          links[i].own = NULL;
+          links[i].wait = &locks[i];
+          thread_create ("waiter", PRI_MIN + 1 + i, chain_thread, &links[i]);
+        }
+
+      start = timer_rdtsc ();
+      lock_release (&locks[held]);
+      end = timer_rdtsc ();
+      if (end - start < best)
+        best = end - start;
+
+      for (i = 0; i < held; i++)
+        lock_release (&locks[i]);
+    }
+  thread_set_priority (PRI_DEFAULT);
+  return timer_tsc_to_ns (best);
+}
+
+/* Holds LINK->own, if any, while acquiring and releasing
+   LINK->wait. */
+static void
+chain_thread (void *link_)
+{
+  struct chain_link *link = link_;
+
+  if (link->own != NULL)
+    lock_acquire (link->own);
+  lock_acquire (link->wait);
+  lock_release (link->wait);
+  if (link->own != NULL)
+    lock_release (link->own);
+}
+
+/* Records the time and blocks on LOCK_, donating to its holder. */
+static void
+donor_thread (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  donate_start = timer_rdtsc ();
+  lock_acquire (lock);
+  lock_release (lock);
+}
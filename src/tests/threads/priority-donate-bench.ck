@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+
+check_bench (map ("donation through $_ locks", 1, 2, 4, 8),
+	     map ("release holding $_ other locks", 0, 4, 16));
+pass;
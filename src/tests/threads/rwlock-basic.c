@@ -0,0 +1,95 @@
+/* Checks the readers-writer lock in synch.c: that readers share
+   it, that the try variants fail exactly when they should, that a
+   waiting writer gets in before a reader that arrives after it,
+   and that downgrading a write hold to a read hold does not let
+   a waiting writer in before the read hold is released.
+
+   The threads created here have higher priority than the main
+   thread, so each runs as soon as it is created or unblocked,
+   and the order of their messages shows who got in when. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_basic (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+
+  /* Readers share the lock. */
+  rwlock_acquire_read (&rw);
+  thread_create ("reader1", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  msg ("reader1 must already have finished while main reads.");
+
+  /* Try variants. */
+  if (rwlock_try_acquire_write (&rw))
+    fail ("got write lock while main reads");
+  if (!rwlock_try_acquire_read (&rw))
+    fail ("could not get second read lock while main reads");
+  rwlock_release_read (&rw);
+  rwlock_release_read (&rw);
+  if (!rwlock_try_acquire_write (&rw))
+    fail ("could not get write lock on free rwlock");
+  if (rwlock_try_acquire_read (&rw))
+    fail ("got read lock while main writes");
+  if (!rwlock_held_for_write (&rw))
+    fail ("write lock not held after rwlock_try_acquire_write()");
+  rwlock_release_write (&rw);
+  msg ("try variants ok.");
+
+  /* A waiting writer goes before a reader that arrives later. */
+  rwlock_acquire_read (&rw);
+  thread_create ("writer1", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  msg ("writer1 should be waiting for main to stop reading.");
+  thread_create ("reader2", PRI_DEFAULT + 2, reader_thread_func, &rw);
+  msg ("reader2 should be waiting behind writer1.");
+  if (rwlock_try_acquire_read (&rw))
+    fail ("got read lock while a writer waits");
+  rwlock_release_read (&rw);
+  msg ("writer1, reader2 must already have finished, in that order.");
+
+  /* Downgrading keeps a waiting writer out until the read hold
+     is released. */
+  rwlock_acquire_write (&rw);
+  thread_create ("writer2", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  rwlock_downgrade (&rw);
+  msg ("main reads after downgrading, writer2 should be waiting.");
+  rwlock_release_read (&rw);
+  msg ("writer2 must already have finished.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("%s: got the read lock", thread_name ());
+  rwlock_release_read (rw);
+  msg ("%s: done", thread_name ());
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("%s: got the write lock", thread_name ());
+  rwlock_release_write (rw);
+  msg ("%s: done", thread_name ());
+}
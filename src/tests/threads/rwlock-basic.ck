@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-basic) begin
+(rwlock-basic) reader1: got the read lock
+(rwlock-basic) reader1: done
+(rwlock-basic) reader1 must already have finished while main reads.
+(rwlock-basic) try variants ok.
+(rwlock-basic) writer1 should be waiting for main to stop reading.
+(rwlock-basic) reader2 should be waiting behind writer1.
+(rwlock-basic) writer1: got the write lock
+(rwlock-basic) reader2: got the read lock
+(rwlock-basic) reader2: done
+(rwlock-basic) writer1: done
+(rwlock-basic) writer1, reader2 must already have finished, in that order.
+(rwlock-basic) main reads after downgrading, writer2 should be waiting.
+(rwlock-basic) writer2: got the write lock
+(rwlock-basic) writer2: done
+(rwlock-basic) writer2 must already have finished.
+(rwlock-basic) end
+EOF
+pass;
@@ -0,0 +1,94 @@
+/* Checks that the stride scheduler divides the CPU in proportion
+   to tickets.
+
+   Three CPU-bound threads with priorities 9, 19, and 29, that is,
+   with 10, 20, and 30 tickets, spin for 20 seconds and count the
+   timer ticks during which they run.  They should receive 1/6,
+   2/6, and 3/6 of the ticks.  Stride scheduling bounds each
+   thread's error by a few time slices no matter how long it runs,
+   so the test allows each share to be off by 3% of the total. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 3
+#define TOLERANCE_PCT 3
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int tick_count;
+  };
+
+static void load_thread (void *aux);
+
+void
+test_stride_share (void) 
+{
+  struct thread_info info[THREAD_CNT];
+  int64_t start_time;
+  int total = 0;
+  int i;
+
+  ASSERT (thread_stride);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+
+      info[i].start_time = start_time;
+      info[i].tick_count = 0;
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, 10 * (i + 1) - 1, load_thread, &info[i]);
+    }
+
+  msg ("Sleeping 25 seconds to let threads run, please wait...");
+  timer_sleep (25 * TIMER_FREQ);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    total += info[i].tick_count;
+  if (total == 0)
+    fail ("threads received no ticks");
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      int tickets = 10 * (i + 1);
+      int expected = total * tickets / 60;
+      int error = info[i].tick_count - expected;
+
+      if (error < 0)
+        error = -error;
+      if (error * 100 > total * TOLERANCE_PCT)
+        fail ("thread %d with %d tickets received %d of %d ticks, "
+              "expected about %d", i, tickets, info[i].tick_count, total,
+              expected);
+      msg ("Thread %d with %d tickets received its share.", i, tickets);
+    }
+}
+
+/* Sleeps until 2 seconds after the start time, so that all the
+   threads start together, then spins for 20 seconds, counting
+   the ticks during which it runs. */
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 2 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 20 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stride-share) begin
+(stride-share) Starting 3 threads...
+(stride-share) Sleeping 25 seconds to let threads run, please wait...
+(stride-share) Thread 0 with 10 tickets received its share.
+(stride-share) Thread 1 with 20 tickets received its share.
+(stride-share) Thread 2 with 30 tickets received its share.
+(stride-share) end
+EOF
+pass;
@@ -0,0 +1,111 @@
+/* Checks queuing, delayed queuing, cancelling, and flushing of
+   work on a workqueue.
+
+   The queue's one worker thread runs at PRI_MIN, so it only gets
+   to run while the main thread is blocked in workqueue_flush()
+   or timer_sleep().  Until then, queued work stays pending. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* Work that records how many times, and at which tick, it ran. */
+struct counted_work
+  {
+    struct work work;
+    int run_cnt;                /* Number of times run. */
+    int64_t run_tick;           /* Tick of last run. */
+  };
+
+static work_func count_run;
+static work_func sleep_then_count;
+static void counted_init (struct counted_work *, work_func *);
+
+void
+test_workqueue_basic (void) 
+{
+  static struct workqueue wq;
+  struct counted_work a, b, c, d, e;
+  int64_t start;
+
+  if (!workqueue_create (&wq, "test", 1, PRI_MIN))
+    fail ("workqueue_create failed");
+
+  /* Queued work runs once, even if queued twice. */
+  counted_init (&a, count_run);
+  if (!queue_work (&wq, &a.work))
+    fail ("queue_work failed");
+  if (queue_work (&wq, &a.work))
+    fail ("queue_work succeeded on pending work");
+  workqueue_flush (&wq);
+  msg ("queued work ran %d time(s)", a.run_cnt);
+
+  /* Cancelled work does not run. */
+  counted_init (&b, count_run);
+  queue_work (&wq, &b.work);
+  if (!cancel_work (&b.work))
+    fail ("cancel_work failed on pending work");
+  if (cancel_work (&b.work))
+    fail ("cancel_work succeeded on cancelled work");
+  workqueue_flush (&wq);
+  msg ("cancelled work ran %d time(s)", b.run_cnt);
+
+  /* Delayed work runs once its delay has passed.  Flushing does
+     not wait for it before then. */
+  counted_init (&c, count_run);
+  start = timer_ticks ();
+  queue_delayed_work (&wq, &c.work, 5);
+  workqueue_flush (&wq);
+  msg ("delayed work ran %d time(s) before its delay", c.run_cnt);
+  timer_sleep (10);
+  workqueue_flush (&wq);
+  msg ("delayed work ran %d time(s) after its delay", c.run_cnt);
+  if (c.run_cnt == 1 && c.run_tick - start < 5)
+    fail ("delayed work ran after %lld ticks, expected at least 5",
+          (long long) (c.run_tick - start));
+
+  /* Cancelled delayed work does not run. */
+  counted_init (&d, count_run);
+  queue_delayed_work (&wq, &d.work, 5);
+  if (!cancel_work (&d.work))
+    fail ("cancel_work failed on delayed work");
+  timer_sleep (10);
+  workqueue_flush (&wq);
+  msg ("cancelled delayed work ran %d time(s)", d.run_cnt);
+
+  /* Flushing waits for work that is running. */
+  counted_init (&e, sleep_then_count);
+  queue_work (&wq, &e.work);
+  workqueue_flush (&wq);
+  msg ("flush returned after sleeping work ran %d time(s)", e.run_cnt);
+}
+
+/* Initializes CW to run FUNC. */
+static void
+counted_init (struct counted_work *cw, work_func *func) 
+{
+  work_init (&cw->work, func, cw);
+  cw->run_cnt = 0;
+  cw->run_tick = 0;
+}
+
+/* Counts a run of the counted_work containing W. */
+static void
+count_run (struct work *w) 
+{
+  struct counted_work *cw = w->aux;
+
+  cw->run_cnt++;
+  cw->run_tick = timer_ticks ();
+}
+
+/* Sleeps, then counts a run of the counted_work containing W. */
+static void
+sleep_then_count (struct work *w) 
+{
+  timer_sleep (5);
+  count_run (w);
+}
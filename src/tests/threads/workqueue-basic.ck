@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-basic) begin
+(workqueue-basic) queued work ran 1 time(s)
+(workqueue-basic) cancelled work ran 0 time(s)
+(workqueue-basic) delayed work ran 0 time(s) before its delay
+(workqueue-basic) delayed work ran 1 time(s) after its delay
+(workqueue-basic) cancelled delayed work ran 0 time(s)
+(workqueue-basic) flush returned after sleeping work ran 1 time(s)
+(workqueue-basic) end
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Child process run by the rusage-children test.
+   Spins in user mode until it has used SPIN_TICKS timer ticks
+   of user time, then exits with code 0. */
+
+#include <rusage.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/userprog/child-spin.h"
+
+const char *test_name = "child-spin";
+
+int
+main (void) 
+{
+  struct rusage usage;
+
+  do 
+    {
+      volatile int i;
+
+      for (i = 0; i < 100000; i++)
+        continue;
+      getrusage (RUSAGE_SELF, &usage);
+    }
+  while (usage.user_ticks < SPIN_TICKS);
+  return 0;
+}
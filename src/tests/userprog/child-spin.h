@@ -0,0 +1,8 @@
+#ifndef TESTS_USERPROG_CHILD_SPIN_H
+#define TESTS_USERPROG_CHILD_SPIN_H
+
+/* Timer ticks of user time that child-spin uses before it
+   exits. */
+#define SPIN_TICKS 10
+
+#endif /* tests/userprog/child-spin.h */
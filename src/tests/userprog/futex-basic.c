@@ -0,0 +1,22 @@
+/* Checks the futex system calls' results with no other process
+   involved: futex_wait() returns FUTEX_AGAIN at once if the int
+   does not hold the expected value, and FUTEX_TIMEDOUT once its
+   timeout expires, after which futex_wake() finds no waiter to
+   wake. */
+
+#include <futex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int x = 5;
+
+  CHECK (futex_wait (&x, 6, FUTEX_FOREVER) == FUTEX_AGAIN,
+         "futex_wait on changed value");
+  CHECK (futex_wait (&x, 5, 20) == FUTEX_TIMEDOUT,
+         "futex_wait with 20 ms timeout");
+  CHECK (futex_wake (&x, 1) == 0, "futex_wake with no waiters");
+}
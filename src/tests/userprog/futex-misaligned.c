@@ -0,0 +1,17 @@
+/* Passes futex_wait() an int address that is not a multiple of
+   4, so that the int straddles two ints, and possibly two pages.
+   The process must be terminated with -1 exit code. */
+
+#include <futex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int x[2] = {0, 0};
+
+  futex_wait ((int *) ((char *) x + 1), 0, FUTEX_FOREVER);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,47 @@
+/* Reads the kernel's memory statistics with memstat() and
+   checks that they add up.  Every page in a pool is either
+   allocated, free, or kept zeroed, and this process's own pages
+   come from the user pool, so that pool cannot be empty. */
+
+#include <memstat.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void check_pool (const char *name, const struct memstat_pool *);
+
+void
+test_main (void) 
+{
+  struct memstat m;
+  int i;
+
+  CHECK (memstat (&m), "memstat");
+  check_pool ("kernel pool", &m.kernel_pool);
+  check_pool ("user pool", &m.user_pool);
+  if (m.user_pool.used == 0)
+    fail ("user pool has no pages allocated");
+
+  for (i = 0; i < MEMSTAT_CLASSES; i++)
+    if (m.classes[i].block_size != 16u << i)
+      fail ("size class %d has %u-byte blocks, expected %u",
+            i, m.classes[i].block_size, 16u << i);
+  msg ("size classes are 16 through %u bytes",
+       m.classes[MEMSTAT_CLASSES - 1].block_size);
+}
+
+/* Checks that pool statistics P, for the pool named NAME, are
+   consistent. */
+static void
+check_pool (const char *name, const struct memstat_pool *p) 
+{
+  if (p->pages == 0)
+    fail ("%s has no pages", name);
+  if (p->used + p->free + p->zeroed != p->pages)
+    fail ("%s: %u used + %u free + %u zeroed != %u pages",
+          name, p->used, p->free, p->zeroed, p->pages);
+  if (p->used_max < p->used)
+    fail ("%s: %u pages used, but at most %u ever",
+          name, p->used, p->used_max);
+  msg ("%s adds up", name);
+}
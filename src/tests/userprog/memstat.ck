@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(memstat) begin
+(memstat) memstat
+(memstat) kernel pool adds up
+(memstat) user pool adds up
+(memstat) size classes are 16 through 1024 bytes
+(memstat) end
+memstat: exit(0)
+EOF
+pass;
@@ -0,0 +1,28 @@
+/* Locks and unlocks a user-space mutex.  With no other process
+   to contend for it, mutex_trylock() must fail while the mutex
+   is held and succeed once it is released.  Marking the mutex
+   as having waiters makes mutex_unlock() call futex_wake(),
+   which must leave the mutex unlocked. */
+
+#include <mutex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct mutex m;
+
+  mutex_init (&m);
+  mutex_lock (&m);
+  CHECK (!mutex_trylock (&m), "trylock of held mutex fails");
+  mutex_unlock (&m);
+  CHECK (mutex_trylock (&m), "trylock of released mutex succeeds");
+
+  m.state = 2;
+  mutex_unlock (&m);
+  CHECK (m.state == 0, "unlock with waiters leaves mutex unlocked");
+  mutex_lock (&m);
+  mutex_unlock (&m);
+}
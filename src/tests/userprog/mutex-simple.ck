@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mutex-simple) begin
+(mutex-simple) trylock of held mutex fails
+(mutex-simple) trylock of released mutex succeeds
+(mutex-simple) unlock with waiters leaves mutex unlocked
+(mutex-simple) end
+mutex-simple: exit(0)
+EOF
+pass;
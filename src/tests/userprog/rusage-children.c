@@ -0,0 +1,37 @@
+/* Runs child-spin, which uses at least SPIN_TICKS timer ticks of
+   user time, and waits for it.  The child's time must then show
+   up in getrusage(RUSAGE_CHILDREN), but not in the parent's own
+   getrusage(RUSAGE_SELF), since the parent was blocked in wait()
+   all along. */
+
+#include <rusage.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/child-spin.h"
+
+void
+test_main (void) 
+{
+  struct rusage self_before, self_after, children;
+
+  CHECK (getrusage (RUSAGE_SELF, &self_before), "getrusage (RUSAGE_SELF)");
+  CHECK (getrusage (RUSAGE_CHILDREN, &children),
+         "getrusage (RUSAGE_CHILDREN)");
+  if (children.user_ticks != 0)
+    fail ("%lld user ticks of children before any child ran",
+          children.user_ticks);
+
+  msg ("wait(exec()) = %d", wait (exec ("child-spin")));
+
+  getrusage (RUSAGE_CHILDREN, &children);
+  getrusage (RUSAGE_SELF, &self_after);
+  if (children.user_ticks < SPIN_TICKS)
+    fail ("children used %lld user ticks, expected at least %d",
+          children.user_ticks, SPIN_TICKS);
+  msg ("children used at least %d user ticks", SPIN_TICKS);
+  if (self_after.user_ticks - self_before.user_ticks >= SPIN_TICKS)
+    fail ("own user ticks grew by %lld while waiting",
+          self_after.user_ticks - self_before.user_ticks);
+  msg ("own user ticks exclude children");
+}
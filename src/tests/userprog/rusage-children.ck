@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rusage-children) begin
+(rusage-children) getrusage (RUSAGE_SELF)
+(rusage-children) getrusage (RUSAGE_CHILDREN)
+child-spin: exit(0)
+(rusage-children) wait(exec()) = 0
+(rusage-children) children used at least 10 user ticks
+(rusage-children) own user ticks exclude children
+(rusage-children) end
+rusage-children: exit(0)
+EOF
+pass;
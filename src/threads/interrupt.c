@@ -47,6 +47,45 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+#ifdef INTR_LATENCY
+/* Interrupts-off latency instrumentation, built in with "make
+   INTR_LATENCY=1".
+
+   Each transition from INTR_ON to INTR_OFF is stamped with the
+   time-stamp counter and the caller's return address, and the
+   transition back to INTR_ON adds the length of the section to
+   a histogram with one bucket per power of 2 cycles and to a
+   table of the LATENCY_TOP longest sections, one per caller.
+   Sections that begin when an interrupt gate turns interrupts
+   off are charged to the interrupt's handler and end when
+   intr_handler() returns to code that had interrupts on.
+
+   Interrupts can also come back on without passing through
+   intr_enable() or the end of intr_handler(), by an `iret' into
+   a newly started user process or by the idle thread's `sti'.
+   Such a section is discarded when the next interrupt shows that
+   interrupts were on.  Only one CPU is tracked. */
+#define LATENCY_BUCKETS 32      /* Histogram buckets, log2 cycles. */
+#define LATENCY_TOP 8           /* Longest sections to remember. */
+
+/* A section with interrupts off. */
+struct latency_section
+  {
+    uint64_t cycles;            /* Length in TSC cycles. */
+    void *eip;                  /* Where interrupts were turned off. */
+  };
+
+static uint64_t latency_start;  /* TSC at start of current section. */
+static void *latency_eip;       /* Caller that started it, or null. */
+static unsigned long long latency_hist[LATENCY_BUCKETS];
+static struct latency_section latency_top[LATENCY_TOP]; /* Descending. */
+
+static void latency_begin (void *eip);
+static void latency_end (void);
+#endif
+
+static enum intr_level disable (void *caller);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -80,7 +119,9 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  return (level == INTR_ON
+          ? intr_enable ()
+          : disable (__builtin_return_address (0)));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
@@ -94,6 +135,10 @@ intr_enable (void)
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
      Hardware Interrupts". */
+#ifdef INTR_LATENCY
+  if (old_level == INTR_OFF)
+    latency_end ();
+#endif
   asm volatile ("sti");
 
   return old_level;
@@ -102,6 +147,14 @@ intr_enable (void)
 /* Disables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_disable (void) 
+{
+  return disable (__builtin_return_address (0));
+}
+
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static inline enum intr_level
+disable (void *caller UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,6 +163,10 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+#ifdef INTR_LATENCY
+  if (old_level == INTR_ON)
+    latency_begin (caller);
+#endif
   return old_level;
 }
 
@@ -225,6 +282,21 @@ intr_yield_on_return (void)
   yield_on_return = true;
 }
 
+/* Returns true if external interrupt VEC_NO has been raised but
+   not yet delivered, for example because interrupts are off. */
+bool
+intr_is_pending (uint8_t vec_no)
+{
+  int irq = vec_no - 0x20;
+  uint16_t port = irq < 8 ? PIC0_CTRL : PIC1_CTRL;
+
+  ASSERT (vec_no >= 0x20 && vec_no < 0x30);
+
+  /* OCW3: read the Interrupt Request Register. */
+  outb (port, 0x0a);
+  return (inb (port) & (1 << (irq & 7))) != 0;
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /* Initializes the PICs.  Refer to [8259A] for details.
@@ -352,6 +424,12 @@ intr_handler (struct intr_frame *frame)
      and they need to be acknowledged on the PIC (see below).
      An external interrupt handler cannot sleep. */
   external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+#ifdef INTR_LATENCY
+  if (frame->eflags & FLAG_IF)
+    latency_eip = NULL;
+  if (intr_get_level () == INTR_OFF)
+    latency_begin ((void *) intr_handlers[frame->vec_no]);
+#endif
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
@@ -386,7 +464,89 @@ intr_handler (struct intr_frame *frame)
       if (yield_on_return) 
         thread_yield (); 
     }
+
+#ifdef INTR_LATENCY
+  /* The `iret' will turn interrupts back on. */
+  if (frame->eflags & FLAG_IF)
+    latency_end ();
+#endif
+}
+
+/* Prints interrupts-off latency statistics, if they were built
+   in. */
+void
+intr_print_stats (void) 
+{
+#ifdef INTR_LATENCY
+  int i;
+
+  printf ("Interrupts off: section length histogram\n");
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    if (latency_hist[i] != 0)
+      printf ("  %10"PRId64" ns+: %llu\n",
+              timer_tsc_to_ns ((uint64_t) 1 << i), latency_hist[i]);
+  printf ("Interrupts off: longest sections\n");
+  for (i = 0; i < LATENCY_TOP && latency_top[i].eip != NULL; i++)
+    printf ("  %10"PRId64" ns at %p\n",
+            timer_tsc_to_ns (latency_top[i].cycles), latency_top[i].eip);
+#endif
+}
+
+#ifdef INTR_LATENCY
+/* Starts timing a section with interrupts off, turned off by
+   EIP, unless one is already being timed.  Interrupts must be
+   off. */
+static void
+latency_begin (void *eip) 
+{
+  if (latency_eip != NULL)
+    return;
+  latency_start = timer_rdtsc ();
+  latency_eip = eip;
+}
+
+/* Ends the section being timed, if any, and records it.
+   Interrupts must be off. */
+static void
+latency_end (void) 
+{
+  uint64_t cycles;
+  uint32_t high, low;
+  int bucket, i;
+
+  if (latency_eip == NULL)
+    return;
+  cycles = timer_rdtsc () - latency_start;
+
+  /* Find the bucket with a bit scan; see [IA32-v2a] "BSR". */
+  high = cycles >> 32;
+  low = cycles;
+  if (high != 0)
+    bucket = LATENCY_BUCKETS - 1;
+  else if (low != 0)
+    asm ("bsrl %1, %0" : "=r" (bucket) : "rm" (low));
+  else
+    bucket = 0;
+  latency_hist[bucket]++;
+
+  /* Keep the longest section for each caller among the top.  If
+     the caller is already there, drop its entry and reinsert it
+     if this section is longer; otherwise replace the last. */
+  for (i = 0; i < LATENCY_TOP; i++)
+    if (latency_top[i].eip == latency_eip)
+      break;
+  if (i == LATENCY_TOP)
+    i = LATENCY_TOP - 1;
+  if (cycles > latency_top[i].cycles || latency_top[i].eip == NULL)
+    {
+      for (; i > 0 && latency_top[i - 1].cycles < cycles; i--)
+        latency_top[i] = latency_top[i - 1];
+      latency_top[i].cycles = cycles;
+      latency_top[i].eip = latency_eip;
+    }
+  latency_eip = NULL;
 }
+#endif
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
    unexpected interrupt is one that has no registered handler. */
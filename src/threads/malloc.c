@@ -1,12 +1,15 @@
 #include "threads/malloc.h"
 #include <debug.h>
 #include <list.h>
+#include <memstat.h>
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -28,6 +31,22 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   In front of the descriptors, each thread has a "magazine" per
+   descriptor, a stack of up to `mag_max' free blocks that it
+   allocates from and frees to without taking the descriptor's
+   lock.  An empty magazine is refilled with half of `mag_max'
+   blocks from the free list, and a full one gives back half of
+   its blocks, under a single lock acquisition.  Blocks in a
+   magazine count as in use as far as their arena is concerned,
+   so an arena is not freed while any of its blocks is cached.
+   A thread's magazines are emptied when it exits.
+
+   For malloc_get_stats(), each thread counts the blocks it
+   allocates, and the bytes requested for them, in its magazines.
+   The counts are small, so they are added to the descriptor's
+   totals, and reset, whenever the thread takes the descriptor's
+   lock anyway, or when they are about to overflow.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
@@ -41,8 +60,21 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    unsigned mag_max;           /* Blocks in a full magazine. */
+    size_t arena_cnt;           /* Number of arenas. */
+    size_t free_cnt;            /* Number of blocks in free_list. */
+    long long allocs;           /* Blocks allocated, except those
+                                   still counted in magazines. */
+    long long requested;        /* Bytes requested for them. */
   };
 
+/* A thread's magazines cache up to about this many bytes of
+   blocks of each size, but at least MAG_MIN and at most MAG_MAX
+   blocks. */
+#define MAG_BYTES 1024
+#define MAG_MIN 2
+#define MAG_MAX 16               /* Must fit in uint8_t. */
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -57,15 +89,40 @@ struct arena
 /* Free block. */
 struct block 
   {
-    struct list_elem free_elem; /* Free list element. */
+    union
+      {
+        struct list_elem free_elem; /* Free list element. */
+        struct block *mag_next;     /* Next block in a magazine. */
+      };
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASSES]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+#if MALLOC_CLASSES != MEMSTAT_CLASSES
+#error MALLOC_CLASSES and MEMSTAT_CLASSES must be equal.
+#endif
+
+/* Big blocks.  Protected by disabling interrupts. */
+static size_t big_cnt;          /* Number of big blocks. */
+static size_t big_page_cnt;     /* Pages in big blocks. */
+static long long big_allocs;    /* Big blocks ever allocated. */
+
+#ifdef LOCK_STAT
+/* Lock statistics for each descriptor, named by block size. */
+static struct lock_stat desc_stats[MALLOC_CLASSES];
+static char desc_stat_names[MALLOC_CLASSES][16];
+#endif
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool mag_refill (struct desc *, struct malloc_magazine *);
+static void mag_drain (struct desc *, struct malloc_magazine *,
+                       unsigned cnt);
+static void mag_add_stats (struct desc *, struct malloc_magazine *);
+static void desc_free (struct desc *, struct block *);
+static thread_action_func add_thread_stats;
 
 /* Initializes the malloc() descriptors. */
 void
@@ -79,8 +136,24 @@ malloc_init (void)
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+      d->mag_max = MAG_BYTES / block_size;
+      if (d->mag_max < MAG_MIN)
+        d->mag_max = MAG_MIN;
+      else if (d->mag_max > MAG_MAX)
+        d->mag_max = MAG_MAX;
       list_init (&d->free_list);
+#ifdef LOCK_STAT
+      {
+        struct lock_stat *stat = &desc_stats[desc_cnt - 1];
+        char *name = desc_stat_names[desc_cnt - 1];
+
+        snprintf (name, sizeof desc_stat_names[0], "malloc %zu", block_size);
+        *stat = (struct lock_stat) LOCK_STAT_INITIALIZER (name, true);
+        lock_init_stat (&d->lock, stat);
+      }
+#else
       lock_init (&d->lock);
+#endif
     }
 }
 
@@ -90,8 +163,10 @@ void *
 malloc (size_t size) 
 {
   struct desc *d;
+  struct malloc_magazine *mag;
   struct block *b;
   struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -116,40 +191,31 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+
+      old_level = intr_disable ();
+      big_cnt++;
+      big_page_cnt += page_cnt;
+      big_allocs++;
+      intr_set_level (old_level);
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
+  /* Take a block from our magazine, refilling it if needed. */
+  mag = &thread_current ()->malloc_mags[d - descs];
+  if (mag->cnt == 0 && !mag_refill (d, mag))
+    return NULL;
+  b = mag->top;
+  mag->top = b->mag_next;
+  mag->cnt--;
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  if (mag->allocs == UINT8_MAX || mag->requested > UINT16_MAX - size)
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      lock_acquire (&d->lock);
+      mag_add_stats (d, mag);
+      lock_release (&d->lock);
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  mag->allocs++;
+  mag->requested += size;
   return b;
 }
 
@@ -226,43 +292,249 @@ free (void *p)
       
       if (d != NULL) 
         {
-          /* It's a normal block.  We handle it here. */
+          /* It's a normal block.  Put it in our magazine, first
+             making room if it is full. */
+          struct malloc_magazine *mag
+            = &thread_current ()->malloc_mags[d - descs];
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
-
-          lock_release (&d->lock);
+          if (mag->cnt >= d->mag_max)
+            mag_drain (d, mag, d->mag_max / 2);
+          b->mag_next = mag->top;
+          mag->top = b;
+          mag->cnt++;
         }
       else
         {
           /* It's a big block.  Free its pages. */
+          enum intr_level old_level = intr_disable ();
+          big_cnt--;
+          big_page_cnt -= a->free_cnt;
+          intr_set_level (old_level);
+
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Frees all the blocks in the current thread's magazines.  Must
+   be called by a thread before it exits. */
+void
+malloc_thread_exit (void) 
+{
+  struct thread *cur = thread_current ();
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct malloc_magazine *mag = &cur->malloc_mags[i];
+
+      if (mag->cnt > 0)
+        mag_drain (&descs[i], mag, mag->cnt);
+      else if (mag->allocs > 0)
+        {
+          lock_acquire (&descs[i].lock);
+          mag_add_stats (&descs[i], mag);
+          lock_release (&descs[i].lock);
+        }
+    }
+}
+
+/* Stores statistics for each size class and for big blocks in
+   STAT.
+
+   Takes each descriptor's lock if interrupts are on.  If they are
+   off, as when statistics are printed after a kernel panic,
+   reads the descriptors without their locks, since no other
+   thread can change them then and waiting for a lock is not
+   possible.
+
+   Blocks don't record the size that was requested for them, so
+   the bytes wasted in used blocks are estimated from the average
+   request. */
+void
+malloc_get_stats (struct memstat *stat) 
+{
+  bool locking = intr_get_level () == INTR_ON;
+  enum intr_level old_level;
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct desc *d = &descs[i];
+      struct memstat_class *c = &stat->classes[i];
+
+      if (locking)
+        lock_acquire (&d->lock);
+      c->block_size = d->block_size;
+      c->arenas = d->arena_cnt;
+      c->free = d->free_cnt;
+      c->allocs = d->allocs;
+      c->requested = d->requested;
+      if (locking)
+        lock_release (&d->lock);
+      c->cached = 0;
+    }
+
+  /* Add up the magazines of every thread. */
+  old_level = intr_disable ();
+  thread_foreach (add_thread_stats, stat);
+  stat->big_blocks = big_cnt;
+  stat->big_pages = big_page_cnt;
+  stat->big_allocs = big_allocs;
+  intr_set_level (old_level);
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct memstat_class *c = &stat->classes[i];
+      unsigned total = c->arenas * descs[i].blocks_per_arena;
+      long long used_bytes;
+
+      c->used = total >= c->free + c->cached ? total - c->free - c->cached : 0;
+      used_bytes = (long long) c->used * c->block_size;
+      c->waste = (c->allocs > 0
+                  ? used_bytes - (long long) c->used * c->requested / c->allocs
+                  : 0);
+    }
+}
+
+/* Adds the blocks cached in thread T's magazines, and its
+   allocation counts, to the struct memstat that AUX points to. */
+static void
+add_thread_stats (struct thread *t, void *aux) 
+{
+  struct memstat *stat = aux;
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      stat->classes[i].cached += t->malloc_mags[i].cnt;
+      stat->classes[i].allocs += t->malloc_mags[i].allocs;
+      stat->classes[i].requested += t->malloc_mags[i].requested;
+    }
+}
+
+/* Moves half of D's `mag_max' blocks from D's free list into
+   empty magazine MAG, creating a new arena if the free list runs
+   out.  Returns true if at least one block was added, false if
+   memory is not available. */
+static bool
+mag_refill (struct desc *d, struct malloc_magazine *mag) 
+{
+  unsigned want = d->mag_max / 2;
+
+  ASSERT (mag->cnt == 0);
+
+  lock_acquire (&d->lock);
+  mag_add_stats (d, mag);
+  while (mag->cnt < want)
+    {
+      struct block *b;
+      struct arena *a;
+
+      /* If the free list is empty, create a new arena. */
+      if (list_empty (&d->free_list))
+        {
+          size_t i;
+
+          /* Allocate a page. */
+          a = palloc_get_page (0);
+          if (a == NULL) 
+            break;
+
+          /* Initialize arena and add its blocks to the free list. */
+          a->magic = ARENA_MAGIC;
+          a->desc = d;
+          a->free_cnt = d->blocks_per_arena;
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_push_back (&d->free_list, &b->free_elem);
+            }
+          d->arena_cnt++;
+          d->free_cnt += d->blocks_per_arena;
+        }
+
+      /* Move a block from the free list to the magazine. */
+      b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+      a = block_to_arena (b);
+      a->free_cnt--;
+      d->free_cnt--;
+      b->mag_next = mag->top;
+      mag->top = b;
+      mag->cnt++;
+    }
+  lock_release (&d->lock);
+
+  return mag->cnt > 0;
+}
+
+/* Moves CNT blocks from magazine MAG back to D's free list. */
+static void
+mag_drain (struct desc *d, struct malloc_magazine *mag, unsigned cnt) 
+{
+  ASSERT (cnt <= mag->cnt);
+
+  lock_acquire (&d->lock);
+  mag_add_stats (d, mag);
+  for (; cnt > 0; cnt--)
+    {
+      struct block *b = mag->top;
+
+      mag->top = b->mag_next;
+      mag->cnt--;
+      desc_free (d, b);
+    }
+  lock_release (&d->lock);
+}
+
+/* Adds MAG's allocation counts to D's totals and resets them.
+   D's lock must be held. */
+static void
+mag_add_stats (struct desc *d, struct malloc_magazine *mag) 
+{
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  d->allocs += mag->allocs;
+  d->requested += mag->requested;
+  mag->allocs = mag->requested = 0;
+}
+
+/* Adds block B to D's free list.  If B's arena is then entirely
+   unused, frees the arena.  D's lock must be held. */
+static void
+desc_free (struct desc *d, struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+  d->free_cnt++;
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      palloc_free_page (a);
+      d->arena_cnt--;
+      d->free_cnt -= d->blocks_per_arena;
+    }
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -3,8 +3,31 @@
 
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/* Number of block sizes that malloc() handles itself, 16 bytes
+   through 1 kB.  Larger requests get whole pages. */
+#define MALLOC_CLASSES 7
+
+/* A thread's magazine: a small stack of free blocks of one size,
+   linked through the blocks themselves, that the thread can
+   allocate from and free to without locking.  Every thread has
+   one per size class in its struct thread, so it is kept to 8
+   bytes. */
+struct malloc_magazine
+  {
+    void *top;                  /* Most recently freed block, or null. */
+    uint8_t cnt;                /* Number of blocks. */
+    uint8_t allocs;             /* Blocks allocated, not yet counted
+                                   in the descriptor. */
+    uint16_t requested;         /* Bytes requested for them. */
+  };
+
+struct memstat;
 
 void malloc_init (void);
+void malloc_thread_exit (void);
+void malloc_get_stats (struct memstat *);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
@@ -0,0 +1,68 @@
+#include "threads/memstat.h"
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#ifdef VM
+#include "vm/frame.h"
+#endif
+
+/* Kernel memory statistics.
+
+   Collects the counts kept by the page allocator, malloc(), and
+   the frame table into a struct memstat, for the memstat()
+   system call and for printing at shutdown. */
+
+/* Stores the current memory statistics in STAT. */
+void
+memstat_get (struct memstat *stat) 
+{
+  memset (stat, 0, sizeof *stat);
+  palloc_get_stats (&stat->kernel_pool, &stat->user_pool);
+  malloc_get_stats (stat);
+#ifdef VM
+  frame_table_get_stats (&stat->frames, &stat->frames_max);
+#endif
+}
+
+/* Prints the current memory statistics, except for the page
+   pools, which palloc_print_stats() prints in more detail.
+
+   This is called at shutdown, also after a kernel panic, which
+   may have happened in an interrupt handler or with one of the
+   locks that memstat_get() takes held.  So it reads the counts
+   with interrupts off, which makes malloc and the frame table
+   skip their locks.  Counts that the panicking thread was in the
+   middle of updating may be slightly off. */
+void
+memstat_print (void) 
+{
+  struct memstat stat;
+  enum intr_level old_level;
+  int i;
+
+  memset (&stat, 0, sizeof stat);
+  old_level = intr_disable ();
+  malloc_get_stats (&stat);
+#ifdef VM
+  frame_table_get_stats (&stat.frames, &stat.frames_max);
+#endif
+  intr_set_level (old_level);
+
+  for (i = 0; i < MEMSTAT_CLASSES; i++)
+    {
+      const struct memstat_class *c = &stat.classes[i];
+
+      printf ("Memory: malloc %u: %u arenas, %u blocks used, %u cached, "
+              "%u free, %lld bytes wasted, %lld allocated\n",
+              c->block_size, c->arenas, c->used, c->cached, c->free,
+              c->waste, c->allocs);
+    }
+  printf ("Memory: malloc big blocks: %u using %u pages, %lld allocated\n",
+          stat.big_blocks, stat.big_pages, stat.big_allocs);
+#ifdef VM
+  printf ("Memory: frame table: %u frames (at most %u)\n",
+          stat.frames, stat.frames_max);
+#endif
+}
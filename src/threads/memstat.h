@@ -0,0 +1,9 @@
+#ifndef THREADS_MEMSTAT_H
+#define THREADS_MEMSTAT_H
+
+#include <memstat.h>
+
+void memstat_get (struct memstat *);
+void memstat_print (void);
+
+#endif /* threads/memstat.h */
@@ -1,15 +1,18 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
+#include <list.h>
 #include <inttypes.h>
+#include <memstat.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -23,22 +26,82 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept
+   in blocks of 2**ORDER pages, aligned to their size relative to
+   the start of the pool, on one free list per order.  An
+   allocation takes the smallest block that is big enough,
+   splitting larger blocks in half as needed, and returns the
+   pages past PAGE_CNT in the block to the free lists.  Freeing
+   a block merges it with its "buddy", the other half of the
+   block it was split from, for as long as the buddy is free
+   too.  Both take time proportional to the number of orders.
+
+   Each pool also keeps a few pages already filled with zeros,
+   which the idle thread prepares by calling palloc_zero_idle(),
+   so that single-page PAL_ZERO requests usually need not clear
+   the page themselves.  Those pages count as allocated as far
+   as the buddy allocator is concerned.  When the free lists
+   cannot satisfy a request, the zeroed pages are given back and
+   the request is retried.
+
+   The page allocator is called from the scheduler to free the
+   pages of dying threads, so the pools are protected by
+   spinlocks, with interrupts off, rather than by locks.  The
+   buddy operations are short enough for that. */
+
+/* Number of block orders.  The largest block is 2**(PALLOC_ORDERS
+   - 1) pages, which is also the largest possible allocation. */
+#define PALLOC_ORDERS 16
+
+/* In a pool's page_state, marks the first page of a free
+   block.  The low bits are the block's order. */
+#define FREE_BLOCK 0x80
+
+/* The idle thread keeps up to this many zeroed pages in each
+   pool, but no more than 1/ZERO_FRACTION of the pool. */
+#define ZERO_MAX 64
+#define ZERO_FRACTION 32
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct spinlock lock;               /* Mutual exclusion. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    uint8_t *page_state;                /* FREE_BLOCK | order for the first
+                                           page of each free block, else 0. */
+    struct list free_lists[PALLOC_ORDERS]; /* Free blocks, by order. */
+    size_t free_cnt[PALLOC_ORDERS];     /* Number of blocks in each list. */
+    struct list zeroed;                 /* Pages filled with zeros. */
+    size_t zeroed_cnt;                  /* Number of pages in `zeroed'. */
+    size_t zeroed_max;                  /* Number of pages to keep there. */
+    size_t zeroing;                     /* Pages the idle thread is zeroing. */
+    size_t used;                        /* Pages allocated. */
+    size_t used_max;                    /* Most pages allocated at once. */
+    const char *name;                   /* Name, for statistics. */
   };
 
+/* Statistics for zeroed pages. */
+static unsigned long long zero_hits;    /* PAL_ZERO pages found zeroed. */
+static unsigned long long zero_misses;  /* PAL_ZERO pages we had to clear. */
+static unsigned long long zero_idle_pages; /* Pages zeroed while idle. */
+static uint64_t zero_idle_cycles;       /* Time spent zeroing them. */
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_block (struct pool *, int order);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void *zeroed_pop (struct pool *);
+static bool zeroed_release (struct pool *);
+static void get_pool_stats (struct pool *, struct memstat_pool *);
+static void print_pool_stats (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,24 +134,57 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
-  size_t page_idx;
+  enum intr_level old_level;
+  void *pages = NULL;
+  size_t page_idx = SIZE_MAX;
+  bool zeroed = false;
+  int order;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    if ((size_t) 1 << order >= page_cnt)
+      break;
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  if (order < PALLOC_ORDERS)
+    {
+      old_level = intr_disable ();
+      spinlock_acquire (&pool->lock);
+      if (page_cnt == 1 && (flags & PAL_ZERO))
+        {
+          pages = zeroed_pop (pool);
+          zeroed = pages != NULL;
+          if (zeroed)
+            zero_hits++;
+          else
+            zero_misses++;
+        }
+      if (pages == NULL)
+        {
+          page_idx = alloc_block (pool, order);
+          if (page_idx == SIZE_MAX && zeroed_release (pool))
+            page_idx = alloc_block (pool, order);
+          if (page_idx != SIZE_MAX)
+            {
+              free_range (pool, page_idx + page_cnt,
+                          ((size_t) 1 << order) - page_cnt);
+              pages = pool->base + PGSIZE * page_idx;
+            }
+        }
+      if (pages != NULL)
+        {
+          pool->used += page_cnt;
+          if (pool->used > pool->used_max)
+            pool->used_max = pool->used;
+        }
+      spinlock_release (&pool->lock);
+      intr_set_level (old_level);
+    }
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -118,6 +214,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -132,13 +229,18 @@ palloc_free_multiple (void *pages, size_t page_cnt)
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  spinlock_acquire (&pool->lock);
+  free_range (pool, page_idx, page_cnt);
+  pool->used -= page_cnt;
+  spinlock_release (&pool->lock);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +250,123 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a page for a later PAL_ZERO request, in a pool that has
+   fewer zeroed pages than it keeps.  Returns true if it zeroed a
+   page, false if there was nothing to do.  Called by the idle
+   thread, with interrupts on. */
+bool
+palloc_zero_idle (void) 
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *pool = pools[i];
+      size_t page_idx = SIZE_MAX;
+      uint64_t start;
+      void *page;
+
+      intr_disable ();
+      spinlock_acquire (&pool->lock);
+      if (pool->zeroed_cnt < pool->zeroed_max)
+        {
+          page_idx = alloc_block (pool, 0);
+          if (page_idx != SIZE_MAX)
+            pool->zeroing++;
+        }
+      spinlock_release (&pool->lock);
+      intr_enable ();
+      if (page_idx == SIZE_MAX)
+        continue;
+
+      page = pool->base + PGSIZE * page_idx;
+      start = timer_rdtsc ();
+      memset (page, 0, PGSIZE);
+
+      intr_disable ();
+      zero_idle_cycles += timer_rdtsc () - start;
+      zero_idle_pages++;
+      spinlock_acquire (&pool->lock);
+      list_push_front (&pool->zeroed, page);
+      pool->zeroed_cnt++;
+      pool->zeroing--;
+      spinlock_release (&pool->lock);
+      intr_enable ();
+      return true;
+    }
+  return false;
+}
+
+/* Stores statistics for the kernel pool in KERNEL and for the
+   user pool in USER. */
+void
+palloc_get_stats (struct memstat_pool *kernel, struct memstat_pool *user) 
+{
+  get_pool_stats (&kernel_pool, kernel);
+  get_pool_stats (&user_pool, user);
+}
+
+/* Prints the number of free blocks of each order in each pool,
+   and how well the zeroed pages served PAL_ZERO requests. */
+void
+palloc_print_stats (void) 
+{
+  unsigned long long requests = zero_hits + zero_misses;
+
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+  printf ("Zeroed pages: %llu of %llu PAL_ZERO pages (%llu%%) "
+          "were zeroed while idle",
+          zero_hits, requests, requests ? zero_hits * 100 / requests : 0);
+  if (zero_idle_pages > 0)
+    printf (", saving about %"PRId64" us",
+            timer_tsc_to_ns (zero_idle_cycles / zero_idle_pages * zero_hits)
+            / 1000);
+  printf ("\n");
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's page_state at its base.
+     Calculate the space needed for it
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t state_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  int order;
+
+  if (state_pages > page_cnt)
+    PANIC ("Not enough memory in %s for page state.", name);
+  page_cnt -= state_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  spinlock_init (&p->lock);
+  p->page_state = base;
+  p->base = base + state_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->name = name;
+  list_init (&p->zeroed);
+  p->zeroed_cnt = p->zeroing = 0;
+  p->used = p->used_max = 0;
+  p->zeroed_max = page_cnt / ZERO_FRACTION < ZERO_MAX
+                  ? page_cnt / ZERO_FRACTION : ZERO_MAX;
+  memset (p->page_state, 0, page_cnt);
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    {
+      list_init (&p->free_lists[order]);
+      p->free_cnt[order] = 0;
+    }
+
+  /* Interrupts are still off this early in boot. */
+  spinlock_acquire (&p->lock);
+  free_range (p, 0, page_cnt);
+  spinlock_release (&p->lock);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +376,199 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the address of the page at PAGE_IDX in POOL. */
+static inline struct list_elem *
+page_elem (struct pool *pool, size_t page_idx) 
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Removes a block of 2**ORDER pages from POOL's free lists,
+   splitting a larger block if necessary, and returns the index
+   of its first page, or SIZE_MAX if no block is big enough.
+   POOL's lock must be held. */
+static size_t
+alloc_block (struct pool *pool, int order) 
+{
+  size_t page_idx;
+  int o;
+
+  ASSERT (spinlock_held (&pool->lock));
+
+  for (o = order; o < PALLOC_ORDERS; o++)
+    if (!list_empty (&pool->free_lists[o]))
+      break;
+  if (o >= PALLOC_ORDERS)
+    return SIZE_MAX;
+
+  page_idx = pg_no (list_pop_front (&pool->free_lists[o]))
+             - pg_no (pool->base);
+  pool->free_cnt[o]--;
+  pool->page_state[page_idx] = 0;
+
+  /* Split, putting the upper half back each time. */
+  while (o > order)
+    {
+      size_t buddy;
+
+      o--;
+      buddy = page_idx + ((size_t) 1 << o);
+      pool->page_state[buddy] = FREE_BLOCK | o;
+      list_push_front (&pool->free_lists[o], page_elem (pool, buddy));
+      pool->free_cnt[o]++;
+    }
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, as the
+   largest aligned blocks that cover them.  POOL's lock must be
+   held. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < PALLOC_ORDERS
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && (size_t) 2 << order <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging
+   it with its buddy for as long as the buddy is free.  POOL's
+   lock must be held. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  ASSERT (spinlock_held (&pool->lock));
+  ASSERT (pool->page_state[page_idx] == 0);
+
+  while (order + 1 < PALLOC_ORDERS)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->page_state[buddy] != (FREE_BLOCK | order))
+        break;
+      list_remove (page_elem (pool, buddy));
+      pool->free_cnt[order]--;
+      pool->page_state[buddy] = 0;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+
+  pool->page_state[page_idx] = FREE_BLOCK | order;
+  list_push_front (&pool->free_lists[order], page_elem (pool, page_idx));
+  pool->free_cnt[order]++;
+}
+
+/* Removes and returns a zeroed page from POOL, or returns a null
+   pointer if it has none.  POOL's lock must be held. */
+static void *
+zeroed_pop (struct pool *pool) 
+{
+  struct list_elem *page;
+
+  ASSERT (spinlock_held (&pool->lock));
+
+  if (list_empty (&pool->zeroed))
+    return NULL;
+  page = list_pop_front (&pool->zeroed);
+  pool->zeroed_cnt--;
+
+  /* The page was linked into the list through its first bytes. */
+  memset (page, 0, sizeof *page);
+  return page;
+}
+
+/* Returns all of POOL's zeroed pages to its free lists.  Returns
+   true if there were any.  POOL's lock must be held. */
+static bool
+zeroed_release (struct pool *pool) 
+{
+  bool released = !list_empty (&pool->zeroed);
+
+  ASSERT (spinlock_held (&pool->lock));
+
+  while (!list_empty (&pool->zeroed))
+    {
+      struct list_elem *page = list_pop_front (&pool->zeroed);
+      free_block (pool, pg_no (page) - pg_no (pool->base), 0);
+    }
+  pool->zeroed_cnt = 0;
+  return released;
+}
+
+/* Stores POOL's statistics in STAT.  A page that the idle thread
+   is zeroing counts as zeroed already, so that the used, free,
+   and zeroed pages always add up to the whole pool. */
+static void
+get_pool_stats (struct pool *pool, struct memstat_pool *stat) 
+{
+  enum intr_level old_level;
+  int order;
+
+  old_level = intr_disable ();
+  spinlock_acquire (&pool->lock);
+  stat->pages = pool->page_cnt;
+  stat->used = pool->used;
+  stat->used_max = pool->used_max;
+  stat->free = 0;
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    stat->free += pool->free_cnt[order] << order;
+  stat->zeroed = pool->zeroed_cnt + pool->zeroing;
+  spinlock_release (&pool->lock);
+  intr_set_level (old_level);
+}
+
+/* Prints POOL's used, free, and zeroed page counts and free
+   blocks by order.
+
+   This is called at shutdown, also after a kernel panic, which
+   may have happened while POOL's lock was held, for example on
+   a double free.  So if the lock is busy, prints a note instead
+   of waiting for a lock that will never be released. */
+static void
+print_pool_stats (struct pool *pool) 
+{
+  size_t free_cnt[PALLOC_ORDERS];
+  size_t free_pages = 0;
+  size_t zeroed_cnt, used, used_max;
+  enum intr_level old_level;
+  int order;
+
+  old_level = intr_disable ();
+  if (!spinlock_try_acquire (&pool->lock))
+    {
+      intr_set_level (old_level);
+      printf ("%s: busy, no statistics\n", pool->name);
+      return;
+    }
+  memcpy (free_cnt, pool->free_cnt, sizeof free_cnt);
+  zeroed_cnt = pool->zeroed_cnt + pool->zeroing;
+  used = pool->used;
+  used_max = pool->used_max;
+  spinlock_release (&pool->lock);
+  intr_set_level (old_level);
+
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    free_pages += free_cnt[order] << order;
+  printf ("%s: %zu of %zu pages used (at most %zu), %zu free, %zu zeroed, "
+          "free blocks by order:", pool->name, used, pool->page_cnt,
+          used_max, free_pages, zeroed_cnt);
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    printf (" %zu", free_cnt[order]);
+  printf ("\n");
+}
@@ -0,0 +1,301 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#ifdef FILESYS
+#include "devices/block.h"
+#endif
+
+/* If true, sample at each timer interrupt.  Controlled by kernel
+   command-line option "-profile". */
+bool profile_enabled;
+
+/* Histogram of kernel samples, one counter for each
+   PROFILE_GRAIN bytes of kernel text, allocated by
+   profile_init() to cover _start up to _end_kernel_text. */
+#define PROFILE_SHIFT 4
+#define PROFILE_GRAIN (1 << PROFILE_SHIFT)
+static uint32_t *kernel_hist;
+static size_t kernel_bucket_cnt;
+static size_t kernel_hist_pages;
+
+/* Ring of the call chains of the most recent PROFILE_STACKS
+   kernel samples, innermost return address first, for
+   folded-stack output.  Chains are found by following saved
+   frame pointers, which Make.config tells the compiler to keep
+   with -fno-omit-frame-pointer.  A chain stops early at a frame
+   pointer outside the thread's stack page or a return address
+   outside kernel text. */
+#define PROFILE_STACKS 1024             /* Must be a power of 2. */
+#define PROFILE_DEPTH 8
+struct profile_stack
+  {
+    uintptr_t eip[PROFILE_DEPTH];       /* Zero-terminated if short. */
+  };
+static struct profile_stack *stacks;
+static size_t stacks_pages;
+static uint32_t stack_head;             /* Total chains recorded. */
+
+/* User samples per process, in a small open-addressed table
+   keyed by tid.  Samples of processes that don't fit are counted
+   in user_other. */
+#define PROFILE_PROCS 64                /* Must be a power of 2. */
+struct profile_proc
+  {
+    tid_t tid;                          /* 0 if the slot is free. */
+    char name[16];                      /* Process name. */
+    uint32_t samples;                   /* Samples taken in user mode. */
+  };
+static struct profile_proc procs[PROFILE_PROCS];
+static uint32_t user_other;
+
+static uint32_t kernel_samples;         /* Samples in kernel text. */
+static uint32_t other_samples;          /* Kernel samples elsewhere. */
+
+/* Kernel text bounds, from kernel.lds.S. */
+extern char _start, _end_kernel_text;
+
+/* Where profile_emit() sends output. */
+struct profile_out
+  {
+#ifdef FILESYS
+    struct block *block;                /* Scratch device, or null. */
+    block_sector_t sector;              /* Next sector to write. */
+    uint8_t *buffer;                    /* Partial sector. */
+    size_t ofs;                         /* Bytes used in buffer. */
+#else
+    int unused;
+#endif
+  };
+
+static void record_stack (const struct intr_frame *);
+static void profile_write (struct profile_out *);
+static void profile_emit (struct profile_out *, const char *format, ...)
+  PRINTF_FORMAT (2, 3);
+
+/* Allocates the profile buffers, if profiling is enabled.  Must
+   be called after palloc_init(). */
+void
+profile_init (void) 
+{
+  if (!profile_enabled)
+    return;
+
+  kernel_bucket_cnt = ((uintptr_t) &_end_kernel_text - (uintptr_t) &_start
+                       + PROFILE_GRAIN - 1) >> PROFILE_SHIFT;
+  kernel_hist_pages = DIV_ROUND_UP (kernel_bucket_cnt * sizeof *kernel_hist,
+                                    PGSIZE);
+  stacks_pages = DIV_ROUND_UP (PROFILE_STACKS * sizeof *stacks, PGSIZE);
+  kernel_hist = palloc_get_multiple (PAL_ZERO, kernel_hist_pages);
+  stacks = palloc_get_multiple (PAL_ZERO, stacks_pages);
+  if (kernel_hist == NULL || stacks == NULL)
+    PANIC ("profile: out of memory");
+}
+
+/* Counts a sample of interrupt frame F.  Use profile_sample()
+   instead, which checks profile_enabled first.  Runs in the
+   timer interrupt. */
+void
+profile_record (const struct intr_frame *f) 
+{
+  uintptr_t eip = (uintptr_t) f->eip;
+
+  if ((f->cs & 3) == 3)
+    {
+      struct thread *t = thread_current ();
+      unsigned i, probe;
+
+      for (probe = 0; probe < PROFILE_PROCS; probe++)
+        {
+          i = (t->tid + probe) & (PROFILE_PROCS - 1);
+          if (procs[i].tid == t->tid)
+            break;
+          if (procs[i].tid == 0)
+            {
+              procs[i].tid = t->tid;
+              strlcpy (procs[i].name, t->name, sizeof procs[i].name);
+              break;
+            }
+        }
+      if (probe < PROFILE_PROCS)
+        procs[i].samples++;
+      else
+        user_other++;
+    }
+  else if (eip >= (uintptr_t) &_start && eip < (uintptr_t) &_end_kernel_text)
+    {
+      kernel_hist[(eip - (uintptr_t) &_start) >> PROFILE_SHIFT]++;
+      kernel_samples++;
+      record_stack (f);
+    }
+  else
+    other_samples++;
+}
+
+/* Prints the profile to the console, if profiling is enabled. */
+void
+profile_print_stats (void) 
+{
+  struct profile_out out;
+
+  if (!profile_enabled)
+    return;
+
+  memset (&out, 0, sizeof out);
+  profile_enabled = false;
+  profile_write (&out);
+  profile_enabled = true;
+}
+
+#ifdef FILESYS
+/* Stops profiling and writes the profile, as text, to the start
+   of the scratch device.  Implements the "profiledump" kernel
+   command-line action. */
+void
+profile_dump (char **argv UNUSED) 
+{
+  static uint8_t buffer[BLOCK_SECTOR_SIZE];
+  struct profile_out out;
+
+  if (!profile_enabled)
+    PANIC ("profiledump: profiling not enabled (use -profile)");
+  profile_enabled = false;
+
+  printf ("Dumping profile to scratch device...\n");
+  out.block = block_get_role (BLOCK_SCRATCH);
+  if (out.block == NULL)
+    PANIC ("couldn't open scratch device");
+  out.sector = 0;
+  out.buffer = buffer;
+  out.ofs = 0;
+  memset (buffer, 0, sizeof buffer);
+
+  profile_write (&out);
+  if (out.ofs > 0)
+    block_write (out.block, out.sector++, buffer);
+}
+#endif
+
+/* Adds the call chain of kernel sample F to the stack ring.
+   Runs in the timer interrupt, so the frame pointer chain is
+   walked only within the page that holds F, which is the
+   interrupted thread's stack. */
+static void
+record_stack (const struct intr_frame *f) 
+{
+  struct profile_stack *s = &stacks[stack_head++ & (PROFILE_STACKS - 1)];
+  uintptr_t base = (uintptr_t) pg_round_down (f);
+  uintptr_t fp = f->ebp;
+  int depth;
+
+  s->eip[0] = (uintptr_t) f->eip;
+  for (depth = 1; depth < PROFILE_DEPTH; depth++)
+    {
+      uint32_t *frame = (uint32_t *) fp;
+
+      if (fp < base || fp + 2 * sizeof (uint32_t) > base + PGSIZE
+          || frame[1] < (uintptr_t) &_start
+          || frame[1] >= (uintptr_t) &_end_kernel_text)
+        break;
+      s->eip[depth] = frame[1];
+      if (frame[0] <= fp)
+        {
+          depth++;
+          break;
+        }
+      fp = frame[0];
+    }
+  if (depth < PROFILE_DEPTH)
+    s->eip[depth] = 0;
+}
+
+/* Writes the whole profile to OUT, in the text format read by
+   utils/pintos-prof:
+
+     PPROF01 begin HZ
+     k ADDRESS COUNT      Kernel samples in the bucket at ADDRESS.
+     x COUNT              Kernel samples outside kernel text.
+     u TID COUNT NAME     User samples of process TID.
+     u 0 COUNT            User samples of other processes.
+     s ADDRESS...         A sampled call chain, innermost first.
+     PPROF01 end */
+static void
+profile_write (struct profile_out *out) 
+{
+  size_t i;
+  uint32_t first;
+
+  profile_emit (out, "PPROF01 begin %d\n", TIMER_FREQ);
+  for (i = 0; i < kernel_bucket_cnt; i++)
+    if (kernel_hist[i] != 0)
+      profile_emit (out, "k %#"PRIxPTR" %"PRIu32"\n",
+                    (uintptr_t) &_start + (i << PROFILE_SHIFT),
+                    kernel_hist[i]);
+  if (other_samples != 0)
+    profile_emit (out, "x %"PRIu32"\n", other_samples);
+  for (i = 0; i < PROFILE_PROCS; i++)
+    if (procs[i].tid != 0)
+      profile_emit (out, "u %d %"PRIu32" %s\n",
+                    procs[i].tid, procs[i].samples, procs[i].name);
+  if (user_other != 0)
+    profile_emit (out, "u 0 %"PRIu32"\n", user_other);
+
+  first = stack_head > PROFILE_STACKS ? stack_head - PROFILE_STACKS : 0;
+  for (; first != stack_head; first++)
+    {
+      const struct profile_stack *s = &stacks[first & (PROFILE_STACKS - 1)];
+      char line[PROFILE_DEPTH * 11 + 3];
+      size_t len;
+      int depth;
+
+      len = snprintf (line, sizeof line, "s");
+      for (depth = 0; depth < PROFILE_DEPTH && s->eip[depth] != 0; depth++)
+        len += snprintf (line + len, sizeof line - len, " %#"PRIxPTR,
+                         s->eip[depth]);
+      profile_emit (out, "%s\n", line);
+    }
+  profile_emit (out, "PPROF01 end\n");
+}
+
+/* Formats a line of output with FORMAT and writes it to OUT:
+   to the scratch device if OUT has one, otherwise to the
+   console. */
+static void
+profile_emit (struct profile_out *out UNUSED, const char *format, ...) 
+{
+  char line[128];
+  va_list args;
+
+  va_start (args, format);
+  vsnprintf (line, sizeof line, format, args);
+  va_end (args);
+
+#ifdef FILESYS
+  if (out->block != NULL)
+    {
+      const char *p;
+
+      for (p = line; *p != '\0'; p++)
+        {
+          if (out->ofs == BLOCK_SECTOR_SIZE)
+            {
+              if (out->sector >= block_size (out->block))
+                PANIC ("profile: out of space on scratch device");
+              block_write (out->block, out->sector++, out->buffer);
+              memset (out->buffer, 0, BLOCK_SECTOR_SIZE);
+              out->ofs = 0;
+            }
+          out->buffer[out->ofs++] = *p;
+        }
+      return;
+    }
+#endif
+  printf ("%s", line);
+}
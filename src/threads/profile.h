@@ -0,0 +1,33 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Sampling profiler.
+
+   When enabled with the "-profile" kernel command-line option,
+   each timer interrupt samples the interrupted instruction.
+   Kernel samples are counted in a histogram of kernel text
+   addresses and, with their call chains, in a ring of recent
+   stacks; user samples are counted per process.  The profile is
+   printed at shutdown and can be written to the scratch device
+   with the "profiledump" action.  utils/pintos-prof symbolizes
+   either one against kernel.o. */
+
+extern bool profile_enabled;
+
+void profile_init (void);
+void profile_record (const struct intr_frame *);
+void profile_print_stats (void);
+void profile_dump (char **argv);
+
+/* Samples interrupt frame F, if profiling is enabled. */
+static inline void
+profile_sample (const struct intr_frame *f)
+{
+  if (profile_enabled)
+    profile_record (f);
+}
+
+#endif /* threads/profile.h */
@@ -0,0 +1,233 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab is a single page that starts with this header,
+   followed by the cache's objects, each `stride' bytes apart.
+   Free objects are linked through a pointer stored at the
+   cache's `link_ofs' in each object: at the start of the object
+   if the cache has no constructor, otherwise just past the end
+   of it, so that freeing does not overwrite constructed state.
+   The header of the slab holding an object is found by rounding
+   the object's address down to a page boundary. */
+struct slab
+  {
+    struct list_elem elem;      /* In cache's `partial' or `full' list. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    void *free;                 /* First free object, or null. */
+    size_t in_use;              /* Number of objects allocated. */
+  };
+
+/* Alignment of objects within a slab. */
+#define SLAB_ALIGN sizeof (void *)
+
+/* Offset of the first object in a slab. */
+#define SLAB_FIRST ROUND_UP (sizeof (struct slab), SLAB_ALIGN)
+
+/* Number of slabs with no allocated objects that a cache keeps,
+   instead of returning them to the page allocator, so that a
+   cache whose use goes up and down around a slab boundary does
+   not allocate and free a page each time. */
+#define SLAB_EMPTY_MAX 1
+
+/* All the caches, for statistics. */
+static struct list caches = LIST_INITIALIZER (caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static void **free_link (const struct kmem_cache *, void *obj);
+
+/* Initializes CACHE to hand out objects of SIZE bytes, naming it
+   NAME.  If CTOR is nonnull, it is called on each object when
+   its slab is created.  Allocates no memory until the first
+   kmem_cache_alloc(), so it may be called before the page
+   allocator is initialized. */
+void
+kmem_cache_init (struct kmem_cache *cache, const char *name, size_t size,
+                 kmem_ctor_func *ctor) 
+{
+  enum intr_level old_level;
+
+  ASSERT (cache != NULL);
+  ASSERT (size > 0);
+
+  cache->name = name;
+  cache->size = size;
+  cache->ctor = ctor;
+  if (ctor == NULL)
+    {
+      cache->link_ofs = 0;
+      cache->stride = ROUND_UP (size > sizeof (void *) ? size : sizeof (void *),
+                                SLAB_ALIGN);
+    }
+  else
+    {
+      cache->link_ofs = ROUND_UP (size, SLAB_ALIGN);
+      cache->stride = cache->link_ofs + sizeof (void *);
+    }
+  ASSERT (cache->stride <= PGSIZE - SLAB_FIRST);
+  cache->objs_per_slab = (PGSIZE - SLAB_FIRST) / cache->stride;
+
+  lock_init (&cache->lock);
+  list_init (&cache->partial);
+  list_init (&cache->full);
+  cache->slab_cnt = cache->empty_cnt = cache->in_use = 0;
+  cache->allocs = cache->frees = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&caches, &cache->elem);
+  intr_set_level (old_level);
+}
+
+/* Obtains and returns an object from CACHE, or a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *cache) 
+{
+  struct slab *slab;
+  void *obj;
+
+  lock_acquire (&cache->lock);
+  if (list_empty (&cache->partial))
+    {
+      slab = slab_create (cache);
+      if (slab == NULL)
+        {
+          lock_release (&cache->lock);
+          return NULL;
+        }
+      list_push_front (&cache->partial, &slab->elem);
+    }
+  else
+    slab = list_entry (list_front (&cache->partial), struct slab, elem);
+
+  /* Take the first free object. */
+  obj = slab->free;
+  slab->free = *free_link (cache, obj);
+  if (slab->in_use++ == 0)
+    cache->empty_cnt--;
+  if (slab->free == NULL)
+    {
+      list_remove (&slab->elem);
+      list_push_front (&cache->full, &slab->elem);
+    }
+  cache->in_use++;
+  cache->allocs++;
+  lock_release (&cache->lock);
+
+  return obj;
+}
+
+/* Frees OBJ, which must have been obtained from CACHE.  If OBJ
+   is a null pointer, does nothing. */
+void
+kmem_cache_free (struct kmem_cache *cache, void *obj) 
+{
+  struct slab *slab;
+
+  if (obj == NULL)
+    return;
+
+  slab = pg_round_down (obj);
+  ASSERT (slab->cache == cache);
+  ASSERT (((uintptr_t) obj - (uintptr_t) slab - SLAB_FIRST)
+          % cache->stride == 0);
+
+#ifndef NDEBUG
+  /* Clear the object, to help detect use-after-free bugs.
+     Constructed state has to survive. */
+  if (cache->ctor == NULL)
+    memset (obj, 0xcc, cache->size);
+#endif
+
+  lock_acquire (&cache->lock);
+  ASSERT (slab->in_use > 0);
+  if (slab->free == NULL)
+    {
+      list_remove (&slab->elem);
+      list_push_front (&cache->partial, &slab->elem);
+    }
+  *free_link (cache, obj) = slab->free;
+  slab->free = obj;
+  cache->in_use--;
+  cache->frees++;
+
+  if (--slab->in_use == 0)
+    {
+      if (cache->empty_cnt >= SLAB_EMPTY_MAX)
+        {
+          list_remove (&slab->elem);
+          cache->slab_cnt--;
+          palloc_free_page (slab);
+        }
+      else
+        cache->empty_cnt++;
+    }
+  lock_release (&cache->lock);
+}
+
+/* Prints statistics for each cache. */
+void
+kmem_cache_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      printf ("Cache %s: %zu-byte objects (%zu per slab), %zu in use, "
+              "%zu slabs, %llu allocs, %llu frees\n",
+              c->name, c->size, c->objs_per_slab, c->in_use,
+              c->slab_cnt, c->allocs, c->frees);
+    }
+}
+
+/* Allocates a new slab for CACHE, with all of its objects free
+   and constructed.  Returns the new slab, or a null pointer if
+   memory is not available.  CACHE's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *cache) 
+{
+  struct slab *slab;
+  uint8_t *obj;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache->lock));
+
+  slab = palloc_get_page (0);
+  if (slab == NULL)
+    return NULL;
+  slab->cache = cache;
+  slab->free = NULL;
+  slab->in_use = 0;
+
+  /* Build the free list back to front, so that objects are
+     handed out in address order. */
+  obj = (uint8_t *) slab + SLAB_FIRST + cache->objs_per_slab * cache->stride;
+  for (i = 0; i < cache->objs_per_slab; i++)
+    {
+      obj -= cache->stride;
+      if (cache->ctor != NULL)
+        cache->ctor (obj);
+      *free_link (cache, obj) = slab->free;
+      slab->free = obj;
+    }
+
+  cache->slab_cnt++;
+  cache->empty_cnt++;
+  return slab;
+}
+
+/* Returns the location of the free list link in OBJ, a free
+   object in CACHE. */
+static void **
+free_link (const struct kmem_cache *cache, void *obj) 
+{
+  return (void **) ((uint8_t *) obj + cache->link_ofs);
+}
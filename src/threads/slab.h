@@ -0,0 +1,54 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Object caches.
+
+   A cache hands out objects of a single, exact size, packed into
+   one-page slabs obtained from the page allocator, so that small
+   fixed-size kernel objects neither round up to the next power
+   of 2, as with malloc(), nor take a page each.  Allocation and
+   freeing take O(1) time.
+
+   A cache may have a constructor, which is called on each object
+   once, when its slab is created, rather than on every
+   allocation.  An object must be returned to its constructed
+   state before it is freed.  Without a constructor, a newly
+   allocated object's contents are undefined.
+
+   Like malloc(), caches use locks, so they must not be used
+   within an interrupt handler. */
+
+/* Initializes object OBJ. */
+typedef void kmem_ctor_func (void *obj);
+
+/* An object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t size;                /* Object size requested. */
+    size_t stride;              /* Bytes per object in a slab. */
+    size_t link_ofs;            /* Offset of free list link in object. */
+    size_t objs_per_slab;       /* Objects in each slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects the members below. */
+    struct list partial;        /* Slabs with some free objects. */
+    struct list full;           /* Slabs with no free objects. */
+    size_t slab_cnt;            /* Number of slabs. */
+    size_t empty_cnt;           /* Number of slabs with no objects used. */
+    size_t in_use;              /* Objects allocated. */
+    unsigned long long allocs;  /* kmem_cache_alloc() calls that succeeded. */
+    unsigned long long frees;   /* kmem_cache_free() calls. */
+    struct list_elem elem;      /* Element in list of all caches. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_cache_print_stats (void);
+
+#endif /* threads/slab.h */
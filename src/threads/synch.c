@@ -27,10 +27,26 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "devices/timer.h"
+
+static heap_less_func sema_waiter_less;
+static heap_less_func cond_waiter_less;
+
+#ifdef LOCK_STAT
+/* All registered lock and semaphore statistics. */
+static struct list lock_stats = LIST_INITIALIZER (lock_stats);
+
+static void lock_stat_register (struct lock_stat *);
+static void lock_stat_wait (struct lock_stat *, bool contended,
+                            uint64_t start, uint64_t end);
+static list_less_func lock_stat_more_contended;
+#endif
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -40,14 +56,29 @@
      decrement it.
 
    - up or "V": increment the value (and wake up one waiting
-     thread, if any). */
+     thread, if any).
+
+   With LOCK_STAT, sema_init() is a macro that passes the call
+   site's statistics to sema_init_stat(), which accounts SEMA's
+   downs to STAT, if it is nonnull. */
+#ifdef LOCK_STAT
+void
+sema_init_stat (struct semaphore *sema, unsigned value,
+                struct lock_stat *stat) 
+#else
 void
 sema_init (struct semaphore *sema, unsigned value) 
+#endif
 {
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, sema_waiter_less, NULL);
+#ifdef LOCK_STAT
+  sema->stat = stat;
+  if (stat != NULL)
+    lock_stat_register (stat);
+#endif
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,17 +92,31 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+#ifdef LOCK_STAT
+  bool contended;
+  uint64_t start = timer_rdtsc ();
+#endif
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+#ifdef LOCK_STAT
+  contended = sema->value == 0;
+#endif
   while (sema->value == 0) 
     {
-      list_insert_ordered(&sema->waiters, &thread_current ()->elem, thread_priority_is_bigger, NULL);
+      struct thread *cur = thread_current ();
+
+      heap_insert (&sema->waiters, &cur->sema_elem);
+      cur->waiting_sema = sema;
       thread_block ();
     }
   sema->value--;
+#ifdef LOCK_STAT
+  if (sema->stat != NULL)
+    lock_stat_wait (sema->stat, contended, start, timer_rdtsc ());
+#endif
   intr_set_level (old_level);
 }
 
@@ -93,6 +138,10 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true; 
+#ifdef LOCK_STAT
+      if (sema->stat != NULL)
+        sema->stat->acquisitions++;
+#endif
     }
   else
     success = false;
@@ -102,7 +151,8 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.
 
    This function may be called from an interrupt handler. */
 void
@@ -113,13 +163,25 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  list_sort(&sema->waiters, thread_priority_is_bigger, NULL);
   sema->value++;
+  if (!heap_empty (&sema->waiters))
+    {
+      struct thread *t = heap_entry (heap_pop (&sema->waiters),
+                                     struct thread, sema_elem);
+      t->waiting_sema = NULL;
+      thread_unblock (t);
+    }
   intr_set_level (old_level);
-  if (!list_empty (&sema->waiters)){
-    thread_unblock (list_entry (list_pop_front (&sema->waiters), struct thread, elem));
-  }
+}
 
+/* Returns true if thread A, waiting on a semaphore, has lower
+   priority than thread B. */
+static bool
+sema_waiter_less (const struct heap_elem *a, const struct heap_elem *b,
+                  void *aux UNUSED) 
+{
+  return (heap_entry (a, struct thread, sema_elem)->priority
+          < heap_entry (b, struct thread, sema_elem)->priority);
 }
 
 static void sema_test_helper (void *sema_);
@@ -173,21 +235,80 @@ sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   With LOCK_STAT, lock_init() is a macro that passes the call
+   site's statistics to lock_init_stat(), which accounts LOCK's
+   acquisitions and hold times to STAT, if it is nonnull. */
+#ifdef LOCK_STAT
+void
+lock_init_stat (struct lock *lock, struct lock_stat *stat)
+#else
 void
 lock_init (struct lock *lock)
+#endif
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
   lock->largest_priority = 0;
+#ifdef LOCK_STAT
+  sema_init_stat (&lock->semaphore, 1, NULL);
+  lock->stat = stat;
+  if (stat != NULL)
+    lock_stat_register (stat);
+#else
   sema_init (&lock->semaphore, 1);
+#endif
+}
+
+/* Donates the current thread's priority along the chain of
+   locks that starts at LOCK: to LOCK's holder, to the holder of
+   the lock that holder is waiting on, and so on.  Stops at the
+   first holder that already has at least the donated priority,
+   or after DONATION_DEPTH_MAX links, so the cost is bounded by
+   the chain depth.  Interrupts must be off. */
+static void
+lock_donate (struct lock *lock) 
+{
+  int priority = thread_current ()->priority;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; lock != NULL && lock->holder != NULL
+         && depth < DONATION_DEPTH_MAX; depth++)
+    {
+      if (lock->largest_priority < priority)
+        lock->largest_priority = priority;
+      if (lock->holder->priority >= priority)
+        break;
+      thread_update_priority (lock->holder, priority);
+      trace_event (TRACE_DONATE, lock->holder, priority);
+      lock = lock->holder->waiting_on;
+    }
+}
+
+/* Returns the highest priority among the threads waiting for
+   LOCK, or PRI_MIN if there are none. */
+static int
+lock_waiters_priority (struct lock *lock) 
+{
+  struct heap *waiters = &lock->semaphore.waiters;
+
+  if (heap_empty (waiters))
+    return PRI_MIN;
+  return heap_entry (heap_top (waiters), struct thread, sema_elem)->priority;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If LOCK is held, the current thread records it in its
+   `waiting_on' member and donates its priority along the chain
+   of holders, at most DONATION_DEPTH_MAX deep.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -195,49 +316,39 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
   enum intr_level old_level;
+#ifdef LOCK_STAT
+  uint64_t start = timer_rdtsc ();
+  bool contended;
+#endif
 
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
   old_level = intr_disable ();
+#ifdef LOCK_STAT
+  contended = lock->holder != NULL;
+#endif
 
-  //hread_current()->lock_which_thread_waiting = lock;
-  list_push_front(& thread_current()->lock_which_thread_waiting, &lock->elem_2);
-
-  if(lock->holder != NULL){
-    if(lock->holder->priority < thread_current()->priority){
-      lock->holder->priority = thread_current()->priority;
-    }
-
-    struct list_elem *e;
-    for(e = list_begin(&lock->holder->lock_which_thread_waiting); e != list_end(&lock->holder->lock_which_thread_waiting); e = list_next(e)){
-      struct lock *waiting_lock = list_entry(e, struct lock, elem_2);
-      while(waiting_lock->holder != NULL){
-        if(waiting_lock->holder->priority < thread_current()->priority){
-          waiting_lock->holder->priority = thread_current()->priority;
-          waiting_lock->largest_priority = thread_current()->priority;
-        }
-        waiting_lock = list_entry(list_begin(&waiting_lock->holder->lock_which_thread_waiting), struct lock, elem_2);
-      }
-    }
-  }
-
-  if(lock->holder == NULL){
-    lock->largest_priority = thread_current()->priority;
-  }
-  else {
-    if(lock->largest_priority < thread_current()->priority){
-      lock->largest_priority = thread_current()->priority;
+  /* The MLFQS scheduler does not use priority donation. */
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      cur->waiting_on = lock;
+      lock_donate (lock);
     }
-  }
   sema_down (&lock->semaphore);
-  
-  lock->holder = thread_current ();
-  list_remove(&lock->elem_2);
+  cur->waiting_on = NULL;
 
-  list_insert_ordered(&lock->holder->lock_list_which_thread_hold, &lock->elem, lock_priority_is_bigger, NULL);
+  lock->holder = cur;
+  lock->largest_priority = lock_waiters_priority (lock);
+  list_push_back (&cur->lock_list_which_thread_hold, &lock->elem);
+#ifdef LOCK_STAT
+  lock->acquired = timer_rdtsc ();
+  if (lock->stat != NULL)
+    lock_stat_wait (lock->stat, contended, start, lock->acquired);
+#endif
 
   intr_set_level (old_level);
 }
@@ -258,11 +369,27 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      lock->holder = thread_current ();
+      lock->largest_priority = lock_waiters_priority (lock);
+      list_push_back (&lock->holder->lock_list_which_thread_hold,
+                      &lock->elem);
+#ifdef LOCK_STAT
+      lock->acquired = timer_rdtsc ();
+      if (lock->stat != NULL)
+        lock->stat->acquisitions++;
+#endif
+      intr_set_level (old_level);
+    }
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   The current thread's priority drops to the larger of its
+   undonated priority and the donations still arriving through
+   the other locks it holds, which takes time linear in the
+   number of locks held.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -270,19 +397,45 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  list_remove(&lock->elem);
-  if(list_size(&lock->holder->lock_list_which_thread_hold) == 0 ){
-    lock->holder->priority = lock->holder->priority_before_donation;
-  }
-  else {
-    lock->holder->priority = list_entry(list_begin(&lock->holder->lock_list_which_thread_hold), struct lock, elem)->largest_priority;
-  }
-
+  old_level = intr_disable ();
+  list_remove (&lock->elem);
   lock->holder = NULL;
+#ifdef LOCK_STAT
+  if (lock->stat != NULL)
+    {
+      uint64_t held = timer_rdtsc () - lock->acquired;
+
+      lock->stat->hold_total += held;
+      if (held > lock->stat->hold_max)
+        lock->stat->hold_max = held;
+    }
+#endif
+
+  /* The MLFQS scheduler does not use priority donation. */
+  if (!thread_mlfqs)
+    {
+      int priority = cur->priority_before_donation;
+      struct list_elem *e;
+
+      for (e = list_begin (&cur->lock_list_which_thread_hold);
+           e != list_end (&cur->lock_list_which_thread_hold);
+           e = list_next (e))
+        {
+          struct lock *held = list_entry (e, struct lock, elem);
+          if (held->largest_priority > priority)
+            priority = held->largest_priority;
+        }
+      thread_update_priority (cur, priority);
+    }
+
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -296,11 +449,107 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* Number of entries in the lock contention report. */
+#define LOCK_STAT_TOP 10
+
+/* Prints the LOCK_STAT_TOP most contended locks and semaphores,
+   if statistics were built in. */
+void
+lock_print_stats (void) 
+{
+#ifdef LOCK_STAT
+  struct list_elem *e;
+  int i;
+
+  list_sort (&lock_stats, lock_stat_more_contended, NULL);
+  printf ("Lock contention: %zu call sites, most contended first\n",
+          list_size (&lock_stats));
+  printf ("  %10s %10s %10s %10s %10s %10s  %s\n", "acquired", "contended",
+          "wait us", "max wait", "hold us", "max hold", "name");
+  for (e = list_begin (&lock_stats), i = 0;
+       e != list_end (&lock_stats) && i < LOCK_STAT_TOP;
+       e = list_next (e), i++)
+    {
+      struct lock_stat *s = list_entry (e, struct lock_stat, elem);
+
+      if (s->acquisitions == 0)
+        break;
+      printf ("  %10llu %10llu %10"PRId64" %10"PRId64,
+              s->acquisitions, s->contentions,
+              timer_tsc_to_ns (s->wait_total) / 1000,
+              timer_tsc_to_ns (s->wait_max) / 1000);
+      if (s->is_lock)
+        printf (" %10"PRId64" %10"PRId64,
+                timer_tsc_to_ns (s->hold_total) / 1000,
+                timer_tsc_to_ns (s->hold_max) / 1000);
+      else
+        printf (" %10s %10s", "-", "-");
+      printf ("  %s (%s:%d)\n",
+              s->name + (s->name[0] == '&'), s->file, s->line);
+    }
+#endif
+}
+
+#ifdef LOCK_STAT
+/* Adds STAT to the list of statistics, if it is not there
+   yet. */
+static void
+lock_stat_register (struct lock_stat *stat) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (!stat->registered)
+    {
+      stat->registered = true;
+      list_push_back (&lock_stats, &stat->elem);
+    }
+  intr_set_level (old_level);
+}
+
+/* Accounts to STAT an acquisition that started waiting at
+   time-stamp counter value START and got the lock or semaphore
+   at END, having had to wait if CONTENDED is true.  Interrupts
+   must be off. */
+static void
+lock_stat_wait (struct lock_stat *stat, bool contended,
+                uint64_t start, uint64_t end) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  stat->acquisitions++;
+  if (contended)
+    {
+      uint64_t wait = end - start;
+
+      stat->contentions++;
+      stat->wait_total += wait;
+      if (wait > stat->wait_max)
+        stat->wait_max = wait;
+    }
+}
+
+/* Returns true if the statistics in A show more contention than
+   those in B: more contended acquisitions, or as many but
+   longer total wait. */
+static bool
+lock_stat_more_contended (const struct list_elem *a_,
+                          const struct list_elem *b_, void *aux UNUSED) 
+{
+  const struct lock_stat *a = list_entry (a_, struct lock_stat, elem);
+  const struct lock_stat *b = list_entry (b_, struct lock_stat, elem);
+
+  if (a->contentions != b->contentions)
+    return a->contentions > b->contentions;
+  return a->wait_total > b->wait_total;
+}
+#endif
+
+/* One semaphore in a condition variable's waiters heap. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -311,7 +560,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -338,6 +587,7 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -345,9 +595,13 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
 
-  waiter.semaphore.sema_priority = thread_current()->priority;
-  list_insert_ordered(&cond->waiters, &waiter.elem, sema_priority_is_bigger, NULL);
+  old_level = intr_disable ();
+  heap_insert (&cond->waiters, &waiter.elem);
+  waiter.thread->waiting_cond = cond;
+  waiter.thread->cond_elem = &waiter.elem;
+  intr_set_level (old_level);
 
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -355,8 +609,8 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one to wake up from
+   its wait.  LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -369,10 +623,42 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  list_sort(&cond->waiters, sema_priority_is_bigger, NULL);
+  if (!heap_empty (&cond->waiters)) 
+    {
+      struct semaphore_elem *waiter;
+      enum intr_level old_level;
+
+      old_level = intr_disable ();
+      waiter = heap_entry (heap_pop (&cond->waiters),
+                           struct semaphore_elem, elem);
+      waiter->thread->waiting_cond = NULL;
+      intr_set_level (old_level);
+      sema_up (&waiter->semaphore);
+    }
+}
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters), struct semaphore_elem, elem)->semaphore);
+/* Returns true if the thread waiting on semaphore_elem A has
+   lower priority than the one waiting on B. */
+static bool
+cond_waiter_less (const struct heap_elem *a, const struct heap_elem *b,
+                  void *aux UNUSED) 
+{
+  return (heap_entry (a, struct semaphore_elem, elem)->thread->priority
+          < heap_entry (b, struct semaphore_elem, elem)->thread->priority);
+}
+
+/* Restores the order of the waiter heaps that blocked thread T
+   is in, after a change to T's priority, for example by priority
+   donation.  Interrupts must be off. */
+void
+synch_priority_changed (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->waiting_sema != NULL)
+    heap_update (&t->waiting_sema->waiters, &t->sema_elem);
+  if (t->waiting_cond != NULL)
+    heap_update (&t->waiting_cond->waiters, t->cond_elem);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -387,22 +673,272 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
+/* Initializes RW as a readers-writer lock.  Any number of
+   readers may hold it at once, or a single writer.
+
+   The writer holds RW's ordinary lock for as long as it writes,
+   so that threads waiting to read or write donate their priority
+   to it just as with lock_acquire().  A reader takes the lock
+   only to get in while a writer holds it or waits for it;
+   otherwise entering and leaving just adjust a counter with
+   interrupts off, so readers do not serialize against each
+   other.
+
+   A writer first acquires the lock, which keeps new readers out,
+   and then waits for the readers already inside to leave.  Thus
+   writers take preference over newly arriving readers and cannot
+   starve.  Readers are not tracked individually, so a writer
+   waiting for readers to leave does not donate its priority to
+   them. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  rw->readers = 0;
+  rw->draining = false;
+  sema_init (&rw->drained, 0);
+}
+
+/* Returns true if a reader may enter RW without waiting: no
+   writer holds or waits for RW's lock.  Interrupts must be
+   off. */
+static bool
+rwlock_read_ready (const struct rwlock *rw) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return (rw->lock.holder == NULL
+          && heap_empty (&rw->lock.semaphore.waiters));
+}
+
+/* Acquires RW for reading, sleeping until any writer is done if
+   necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!lock_held_by_current_thread (&rw->lock));
+
+  old_level = intr_disable ();
+  if (rwlock_read_ready (rw))
+    rw->readers++;
+  else
+    {
+      /* Queue behind the writers, donating to the one holding
+         the lock. */
+      lock_acquire (&rw->lock);
+      rw->readers++;
+      lock_release (&rw->lock);
+    }
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for reading and returns true if
+   successful or false if a writer holds or is waiting for RW.
+   This function will not sleep. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  success = rwlock_read_ready (rw);
+  if (success)
+    rw->readers++;
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader to leave lets in a waiting writer. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->draining)
+    sema_up (&rw->drained);
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until other writers and all
+   readers are done if necessary.  The current thread must not
+   already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+
+  old_level = intr_disable ();
+  if (rw->readers > 0)
+    {
+      rw->draining = true;
+      sema_down (&rw->drained);
+      rw->draining = false;
+    }
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for writing and returns true if
+   successful or false if RW is held by a reader or writer.  This
+   function will not sleep. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool success = false;
+
+  ASSERT (rw != NULL);
+  ASSERT (!lock_held_by_current_thread (&rw->lock));
+
+  old_level = intr_disable ();
+  if (rw->readers == 0 && lock_try_acquire (&rw->lock))
+    success = true;
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases RW, which the current thread must hold for
+   writing. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_release (&rw->lock);
+}
+
+/* Converts the current thread's write hold on RW into a read
+   hold, atomically, so that no other writer can get in between.
+   Readers waiting for RW may then enter too. */
+void
+rwlock_downgrade (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  rw->readers++;
+  lock_release (&rw->lock);
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
 bool
-lock_priority_is_bigger(const struct list_elem *first_elem, const struct list_elem *second_elem, void *aux)
+rwlock_held_for_write (const struct rwlock *rw) 
 {
-  struct lock *first_lock = list_entry(first_elem, struct lock, elem);
-  struct lock *second_lock = list_entry(second_elem, struct lock, elem);
-  return first_lock->largest_priority > second_lock->largest_priority;
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->lock) && rw->readers == 0;
 }
 
+/* Initializes LOCK as an unheld spinlock. */
+void
+spinlock_init (struct spinlock *lock) 
+{
+  ASSERT (lock != NULL);
+
+  lock->locked = 0;
+  lock->holder = NULL;
+}
+
+/* Atomically sets LOCK held, returning true if it was free
+   before.  See [IA32-v2b] "XCHG": an XCHG with a memory operand
+   is locked implicitly. */
+static inline bool
+spinlock_swap (struct spinlock *lock) 
+{
+  int old = 1;
+  asm volatile ("xchgl %0, %1" : "+r" (old), "+m" (lock->locked)
+                : : "memory");
+  return old == 0;
+}
+
+/* Acquires LOCK, spinning until it is free.  Interrupts must be
+   off, and the current thread must not already hold LOCK.
+
+   While waiting, only reads LOCK, so that the spinning CPU does
+   not keep taking the lock's cache line away from the holder,
+   and uses PAUSE to tell the processor it is in a spin loop.
+   See [IA32-v2b] "PAUSE". */
+void
+spinlock_acquire (struct spinlock *lock) 
+{
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!spinlock_held (lock));
+
+  while (!spinlock_swap (lock))
+    while (lock->locked)
+      asm volatile ("pause");
+  lock->holder = thread_current ();
+}
+
+/* Tries to acquire LOCK and returns true if successful or false
+   on failure, without spinning.  Unlike spinlock_acquire(), also
+   fails if the current thread already holds LOCK.  Interrupts
+   must be off. */
+bool
+spinlock_try_acquire (struct spinlock *lock) 
+{
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!spinlock_swap (lock))
+    return false;
+  lock->holder = thread_current ();
+  return true;
+}
+
+/* Releases LOCK, which must be held by the current thread. */
+void
+spinlock_release (struct spinlock *lock) 
+{
+  ASSERT (lock != NULL);
+  ASSERT (spinlock_held (lock));
+
+  lock->holder = NULL;
+  barrier ();
+  lock->locked = 0;
+}
+
+/* Returns true if the current thread holds LOCK, false
+   otherwise. */
 bool
-sema_priority_is_bigger(const struct list_elem *first_elem, const struct list_elem *second_elem, void *aux)
+spinlock_held (const struct spinlock *lock) 
 {
-  struct semaphore_elem *first_sema = list_entry(first_elem, struct semaphore_elem, elem);
-  struct semaphore_elem *second_sema = list_entry(second_elem, struct semaphore_elem, elem);
-  return first_sema->semaphore.sema_priority > second_sema->semaphore.sema_priority;
+  ASSERT (lock != NULL);
+
+  return lock->locked != 0 && lock->holder == thread_current ();
 }
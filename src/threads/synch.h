@@ -1,19 +1,72 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+#ifdef LOCK_STAT
+/* Contention statistics, built in with "make LOCK_STAT=1".
+
+   Every lock and semaphore initialized at a given lock_init() or
+   sema_init() call site shares one struct lock_stat, named after
+   the call's argument, so that locks embedded in short-lived
+   objects are counted without being tracked individually.  Code
+   with several locks of interest at one call site, such as the
+   malloc() descriptors, can give each its own statistics with
+   lock_init_stat().  Times are in time-stamp counter cycles.
+   lock_print_stats() reports the most contended at shutdown. */
+struct lock_stat
+  {
+    const char *name;           /* Expression passed to lock_init(). */
+    const char *file;           /* Source file of the call. */
+    int line;                   /* Source line of the call. */
+    bool is_lock;               /* Lock, as opposed to semaphore? */
+    struct list_elem elem;      /* Element in list of all statistics. */
+    bool registered;            /* In the list yet? */
+    unsigned long long acquisitions;    /* Acquires or downs. */
+    unsigned long long contentions;     /* Those that had to wait. */
+    uint64_t wait_total;        /* Cycles spent waiting. */
+    uint64_t wait_max;          /* Longest wait. */
+    uint64_t hold_total;        /* Cycles locks were held. */
+    uint64_t hold_max;          /* Longest hold. */
+  };
+
+/* Initializer for a struct lock_stat for locks or semaphores
+   named NAME, initialized at the current source line. */
+#define LOCK_STAT_INITIALIZER(NAME, IS_LOCK)                    \
+        { .name = (NAME), .file = __FILE__, .line = __LINE__,   \
+          .is_lock = (IS_LOCK) }
+#endif
+
+void lock_print_stats (void);
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
-
-    int sema_priority;
+    struct heap waiters;        /* Waiting threads, by priority. */
+#ifdef LOCK_STAT
+    struct lock_stat *stat;     /* Statistics, or null. */
+#endif
   };
 
+#ifdef LOCK_STAT
+void sema_init_stat (struct semaphore *, unsigned value, struct lock_stat *);
+#define sema_init(SEMA, VALUE)                                          \
+        do                                                              \
+          {                                                             \
+            static struct lock_stat sema_stat_                          \
+              = LOCK_STAT_INITIALIZER (#SEMA, false);                   \
+            sema_init_stat (SEMA, VALUE, &sema_stat_);                  \
+          }                                                             \
+        while (0)
+#else
 void sema_init (struct semaphore *, unsigned value);
+#endif
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -26,11 +79,30 @@ struct lock
     struct semaphore semaphore; /* Binary semaphore controlling access. */
 
     struct list_elem elem;      /* lock_list_which_thread_hold */
-    struct list_elem elem_2;    /* lock_which_thread_waiting */
-    int largest_priority;
+    int largest_priority;       /* Highest priority donated through
+                                   this lock by its waiters. */
+#ifdef LOCK_STAT
+    struct lock_stat *stat;     /* Statistics, or null. */
+    uint64_t acquired;          /* Time-stamp counter when acquired. */
+#endif
   };
 
+/* Maximum length of a chain of priority donations. */
+#define DONATION_DEPTH_MAX 8
+
+#ifdef LOCK_STAT
+void lock_init_stat (struct lock *, struct lock_stat *);
+#define lock_init(LOCK)                                                 \
+        do                                                              \
+          {                                                             \
+            static struct lock_stat lock_stat_                          \
+              = LOCK_STAT_INITIALIZER (#LOCK, true);                    \
+            lock_init_stat (LOCK, &lock_stat_);                         \
+          }                                                             \
+        while (0)
+#else
 void lock_init (struct lock *);
+#endif
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -39,7 +111,7 @@ bool lock_held_by_current_thread (const struct lock *);
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
   };
 
 void cond_init (struct condition *);
@@ -47,8 +119,48 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-bool lock_priority_is_bigger(const struct list_elem *, const struct list_elem *, void *);
-bool sema_priority_is_bigger(const struct list_elem *first_elem, const struct list_elem *second_elem, void *aux);
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    struct lock lock;           /* Held by the writer. */
+    unsigned readers;           /* Number of readers holding. */
+    bool draining;              /* Writer waiting for readers to leave? */
+    struct semaphore drained;   /* Upped when the last reader leaves. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+void synch_priority_changed (struct thread *);
+
+/* Spinlock.
+
+   Protects data that interrupt handlers or the scheduler use,
+   where sleeping is not an option, such as the page pools in
+   palloc.c.  Must be acquired and released with interrupts off,
+   so that a holder is never preempted and the lock is never held
+   for long.  Acquiring a spinlock that the current thread
+   already holds is an error, caught by an assertion, because it
+   would spin forever. */
+struct spinlock 
+  {
+    volatile int locked;        /* Nonzero while held. */
+    struct thread *holder;      /* Thread holding lock (for debugging). */
+  };
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+bool spinlock_try_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held (const struct spinlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
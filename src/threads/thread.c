@@ -10,8 +10,10 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "lib/kernel/list.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "vm/frame.h"
@@ -22,9 +24,28 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit N of
+   ready_bitmap is set iff ready_queues[N] is nonempty, so the
+   highest-priority ready thread is found with a bit scan.
+
+   Under the stride scheduler, the run queue is instead
+   stride_queue, a heap ordered by pass value.
+
+   Ready threads of the earliest-deadline-first class are kept
+   apart in edf_queue, ordered by deadline, and always run before
+   the other threads.  EDF threads that are waiting for their
+   next release wait in edf_releases, ordered by release time.
+
+   All of these are protected by disabling interrupts. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* # of threads in the run queue. */
+static struct heap stride_queue;
+static struct heap edf_queue;
+static struct heap edf_releases;
+static int64_t stride_pass;     /* Pass of last thread dispatched. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -39,6 +60,25 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Index of live threads by tid, for find_thread_using_tid().
+   hash.c allocates its buckets with malloc(), so threads are
+   indexed starting from thread_start(), once malloc() works, and
+   are removed in thread_exit() while interrupts are still on.
+   Protected by tid_index_lock. */
+static struct hash tid_index;
+static struct lock tid_index_lock;
+
+/* Key for looking up a tid in tid_index, used in place of a
+   whole struct thread, which would not fit well on the stack.
+   The hash functions recognize it through their auxiliary data.
+   Protected by tid_index_lock. */
+struct tid_key
+  {
+    struct hash_elem elem;              /* Hash element. */
+    tid_t tid;                          /* Tid to look up. */
+  };
+static struct tid_key tid_key;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -47,6 +87,20 @@ struct kernel_thread_frame
     void *aux;                  /* Auxiliary data for function. */
   };
 
+/* Cache of pages of dead threads, for reuse by thread_create().
+   Reusing a page skips the page allocator's lock and bitmap
+   scan, and skips zeroing the page: init_thread() clears struct
+   thread, and the rest of the page is stack, which needs no
+   initialization.  Pages are linked through their struct
+   thread's `allelem', and the list is protected by
+   thread_cache_lock because threads die with interrupts off. */
+unsigned thread_cache_max = 16;
+static struct list thread_cache;
+static unsigned thread_cache_cnt;
+static struct spinlock thread_cache_lock;
+static long long thread_cache_hits;
+static long long thread_cache_misses;
+
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
@@ -61,6 +115,65 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the stride scheduler instead of either of the
+   above.  Controlled by kernel command-line option "-stride".
+
+   Each thread holds tickets in proportion to its priority,
+   priority + 1 of them, and has a stride inversely proportional
+   to its tickets.  Each tick a thread runs advances its pass by
+   its stride, and the ready thread with the lowest pass runs
+   next, so over time every thread runs in proportion to its
+   tickets.  A thread that wakes up or is created starts no
+   earlier than the pass of the thread most recently dispatched,
+   so that sleeping does not bank CPU time.  Priority donation
+   works as usual, which here means lending tickets.  See C. A.
+   Waldspurger and W. E. Weihl, "Stride Scheduling: Deterministic
+   Proportional-Share Resource Management", MIT/LCS/TM-528
+   (1995). */
+bool thread_stride;
+#define STRIDE_ONE (1 << 20)            /* Stride of a 1-ticket thread. */
+
+/* Earliest-deadline-first scheduling class.
+
+   An EDF thread runs a job of up to BUDGET ticks once every
+   PERIOD ticks, each of which must finish within DEADLINE ticks
+   of its release.  Ready EDF threads run before all other
+   threads, in order of their current job's deadline, so a
+   thread of the normal classes never preempts one.
+
+   thread_create_edf() admits a thread only if the total density
+   of EDF threads, the sum of BUDGET / min (DEADLINE, PERIOD),
+   stays at or below 1, which guarantees that every deadline can
+   be met on one CPU.  (For DEADLINE >= PERIOD this is the usual
+   utilization bound.)  edf_density is that sum, in units of
+   1 / EDF_DENSITY_ONE, and is protected by disabling interrupts.
+
+   A thread that uses up its budget before ending its job with
+   thread_edf_wait() is throttled by thread_tick() until its
+   next release, so an overrun cannot steal time from the other
+   EDF threads.  A job that ends after its deadline, or is still
+   throttled at its deadline, counts as a deadline miss.  See
+   C. L. Liu and J. W. Layland, "Scheduling Algorithms for
+   Multiprogramming in a Hard-Real-Time Environment", JACM 20:1
+   (1973). */
+#define EDF_DENSITY_ONE 1000000
+static int64_t edf_density;
+
+/* Multi-level feedback queue scheduler state.
+
+   recent_cpu decays once a second for every thread, but only
+   ready and running threads need an up-to-date value, because
+   only they are ordered by priority.  So the per-second update
+   touches just those, and a blocked thread catches up on the
+   seconds it missed when it is unblocked, by replaying the
+   decay coefficients recorded in decay_history.  A thread that
+   missed more than MLFQS_HISTORY seconds has its old recent_cpu
+   treated as fully decayed. */
+#define MLFQS_HISTORY 64                /* Seconds of decay history. */
+static fixed_t load_avg;                /* System load average. */
+static int64_t mlfqs_seconds;           /* # of per-second updates. */
+static fixed_t decay_history[MLFQS_HISTORY]; /* Decay coefficients. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -69,9 +182,36 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void tid_index_insert (struct thread *);
+static hash_hash_func tid_index_hash;
+static hash_less_func tid_index_less;
+static tid_t tid_index_elem_tid (const struct hash_elem *, void *aux);
+static bool is_idle_thread (const struct thread *);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static void ready_queue_move (struct thread *, int priority);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_highest (void);
+static heap_less_func stride_less;
+static int stride_of (const struct thread *);
+static bool is_edf_thread (const struct thread *);
+static int64_t edf_density_of (int64_t period, int64_t budget,
+                               int64_t deadline);
+static heap_less_func edf_deadline_less;
+static heap_less_func edf_release_less;
+static void edf_start_job (struct thread *, int64_t now);
+static void edf_release_due (int64_t now);
+static struct thread *thread_alloc (const char *name, int priority,
+                                    thread_func *, void *aux);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_second (void);
+static void mlfqs_catch_up (struct thread *);
+static int mlfqs_priority (const struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -89,11 +229,20 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_init (&tid_index_lock);
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
+  heap_init (&stride_queue, stride_less, NULL);
+  heap_init (&edf_queue, edf_deadline_less, NULL);
+  heap_init (&edf_releases, edf_release_less, NULL);
   list_init (&all_list);
+  list_init (&thread_cache);
+  spinlock_init (&thread_cache_lock);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -109,6 +258,12 @@ thread_start (void)
 {
   /* Create the idle thread. */
   struct semaphore idle_started;
+
+  /* Index the initial thread, now that malloc() works. */
+  if (!hash_init (&tid_index, tid_index_hash, tid_index_less, &tid_key))
+    PANIC ("could not allocate thread index");
+  tid_index_insert (initial_thread);
+
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
@@ -127,18 +282,55 @@ thread_tick (void)
   struct thread *t = thread_current ();
 
   /* Update statistics. */
-  if (t == idle_thread)
+  if (is_idle_thread (t))
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    {
+      user_ticks++;
+      t->usage.user_ticks++;
+    }
 #endif
   else
-    kernel_ticks++;
+    {
+      kernel_ticks++;
+      t->usage.kernel_ticks++;
+    }
+
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+  else if (thread_stride && !is_idle_thread (t))
+    t->stride_pass += stride_of (t);
+
+  edf_release_due (timer_ticks ());
+
+  /* An EDF thread runs until it ends its job, is preempted by an
+     earlier deadline, or uses up its budget. */
+  if (is_edf_thread (t))
+    {
+      if (--t->edf_remaining <= 0 && !t->edf_throttled)
+        {
+          t->edf_throttled = true;
+          trace_event (TRACE_PREEMPT, t, 0);
+          intr_yield_on_return ();
+        }
+    }
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return ();
+  else if (++thread_ticks >= TIME_SLICE)
+    {
+      trace_event (TRACE_PREEMPT, t, 0);
+      intr_yield_on_return ();
+    }
+}
+
+/* Accounts for CNT timer ticks during which the idle thread ran
+   without timer interrupts, as with tickless idle in
+   devices/timer.c. */
+void
+thread_account_idle (int cnt)
+{
+  idle_ticks += cnt;
 }
 
 /* Prints thread statistics. */
@@ -147,6 +339,8 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld page cache hits, %lld misses\n",
+          thread_cache_hits, thread_cache_misses);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -167,25 +361,98 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
+{
+  struct thread *t = thread_alloc (name, priority, function, aux);
+  tid_t tid;
+
+  if (t == NULL)
+    return TID_ERROR;
+  tid = t->tid;
+
+  /* Add to run queue. */
+  thread_unblock (t);
+
+  return tid;
+}
+
+/* Creates a new kernel thread named NAME in the
+   earliest-deadline-first class, which executes FUNCTION passing
+   AUX as the argument, and adds it to the ready queue.  The
+   thread's first job is released immediately, and it is given
+   BUDGET ticks of CPU time every PERIOD ticks, each job due
+   DEADLINE ticks after its release.  FUNCTION should call
+   thread_edf_wait() at the end of each job.
+
+   Returns the thread identifier for the new thread, or
+   TID_ERROR if creation fails or if admitting the thread would
+   make the EDF threads' total density exceed 1.  The same caveats
+   as for thread_create() apply. */
+tid_t
+thread_create_edf (const char *name, int64_t period, int64_t budget,
+                   int64_t deadline, thread_func *function, void *aux)
+{
+  struct thread *t;
+  enum intr_level old_level;
+  int64_t density;
+  bool admitted;
+  tid_t tid;
+
+  ASSERT (period > 0 && budget > 0 && deadline > 0);
+
+  /* Reserve our share of the CPU before allocating anything. */
+  density = edf_density_of (period, budget, deadline);
+  old_level = intr_disable ();
+  admitted = edf_density + density <= EDF_DENSITY_ONE;
+  if (admitted)
+    edf_density += density;
+  intr_set_level (old_level);
+  if (!admitted)
+    return TID_ERROR;
+
+  t = thread_alloc (name, PRI_MAX, function, aux);
+  if (t == NULL)
+    {
+      old_level = intr_disable ();
+      edf_density -= density;
+      intr_set_level (old_level);
+      return TID_ERROR;
+    }
+  tid = t->tid;
+
+  t->edf_period = period;
+  t->edf_budget = budget;
+  t->edf_rel_deadline = deadline;
+  t->edf_release = timer_ticks ();
+  edf_start_job (t, t->edf_release);
+  thread_unblock (t);
+
+  return tid;
+}
+
+/* Allocates and initializes a new thread for thread_create(),
+   blocked and ready to be passed to thread_unblock().  Returns
+   a null pointer if no memory is available. */
+static struct thread *
+thread_alloc (const char *name, int priority,
+              thread_func *function, void *aux) 
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
-  tid_t tid;
   enum intr_level old_level;
 
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
-  
+  t = thread_page_get ();
   if (t == NULL)
-    return TID_ERROR;
+    return NULL;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
-  tid = t->tid = allocate_tid ();
+  t->tid = allocate_tid ();
+  tid_index_insert (t);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -209,10 +476,7 @@ thread_create (const char *name, int priority,
 
   intr_set_level (old_level);
 
-  /* Add to run queue. */
-  thread_unblock (t);
-
-  return tid;
+  return t;
 }
 
 /* Puts the current thread to sleep.  It will not be scheduled
@@ -224,10 +488,13 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  trace_event (TRACE_BLOCK, cur, 0);
+  cur->status = THREAD_BLOCKED;
   schedule ();
 }
 
@@ -248,17 +515,38 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_insert_ordered(&ready_list, &t->elem, thread_priority_is_bigger, NULL);
+  if (thread_mlfqs)
+    {
+      mlfqs_catch_up (t);
+      t->priority = mlfqs_priority (t);
+    }
+  if (thread_stride && t->stride_pass < stride_pass)
+    t->stride_pass = stride_pass;
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  trace_event (TRACE_WAKEUP, t, running_thread ()->tid);
   intr_set_level (old_level);
 
-  if(idle_thread != thread_current()){
-    if(t->priority > thread_current()->priority){
-      thread_yield();
+  if(!is_idle_thread (thread_current())){
+    struct thread *cur = thread_current ();
+    bool preempt;
+
+    if (is_edf_thread (t) || is_edf_thread (cur))
+      preempt = (is_edf_thread (t)
+                 && (!is_edf_thread (cur)
+                     || t->edf_deadline < cur->edf_deadline));
+    else if (thread_stride)
+      preempt = t->stride_pass < cur->stride_pass;
+    else
+      preempt = t->priority > cur->priority;
+    if(preempt){
+      trace_event (TRACE_PREEMPT, thread_current (), t->tid);
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield();
     }
   }
-
-
 }
 
 /* Returns the name of the running thread. */
@@ -305,10 +593,23 @@ thread_exit (void)
   process_exit ();
 #endif
 
+  /* Remove thread from the tid index, so that later lookups of
+     our tid fail rather than returning a dead thread. */
+  lock_acquire (&tid_index_lock);
+  hash_delete (&tid_index, &thread_current ()->tid_elem);
+  lock_release (&tid_index_lock);
+
+  /* Give back the blocks cached for malloc(). */
+  malloc_thread_exit ();
+
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (is_edf_thread (thread_current ()))
+    edf_density -= edf_density_of (thread_current ()->edf_period,
+                                   thread_current ()->edf_budget,
+                                   thread_current ()->edf_rel_deadline);
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -326,13 +627,76 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-    list_insert_ordered(&ready_list, &cur->elem, thread_priority_is_bigger, NULL);
-  cur->status = THREAD_READY;
+  if (thread_mlfqs)
+    cur->priority = mlfqs_priority (cur);
+  if (cur->edf_throttled)
+    {
+      /* Out of budget: sit out until the next release. */
+      heap_insert (&edf_releases, &cur->edf_elem);
+      cur->status = THREAD_BLOCKED;
+      trace_event (TRACE_BLOCK, cur, 0);
+    }
+  else
+    {
+      if (!is_idle_thread (cur))
+        ready_queue_push (cur);
+      cur->status = THREAD_READY;
+      trace_event (TRACE_YIELD, cur, 0);
+    }
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Ends the running EDF thread's current job.  If the next job's
+   release time has already come, starts it and returns at once;
+   otherwise, sleeps until the release. */
+void
+thread_edf_wait (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now;
+
+  ASSERT (!intr_context ());
+  ASSERT (is_edf_thread (cur));
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  if (now > cur->edf_deadline)
+    cur->edf_misses++;
+  if (cur->edf_release <= now)
+    edf_start_job (cur, now);
+  else
+    {
+      heap_insert (&edf_releases, &cur->edf_elem);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Returns the number of the running EDF thread's jobs that
+   missed their deadline. */
+unsigned
+thread_get_deadline_misses (void) 
+{
+  return thread_current ()->edf_misses;
+}
+
+/* Returns the earliest time at which a waiting EDF thread is due
+   to be released, or INT64_MAX if there is none.
+   Used by tickless idle in devices/timer.c, which must not sleep
+   through a release.  Interrupts must be off. */
+int64_t
+thread_edf_next_release (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (heap_empty (&edf_releases))
+    return INT64_MAX;
+  return heap_entry (heap_top (&edf_releases),
+                     struct thread, edf_elem)->edf_release;
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -354,6 +718,10 @@ thread_foreach (thread_action_func *func, void *aux)
 void
 thread_set_priority (int new_priority) 
 {
+  /* The MLFQS scheduler computes priorities itself. */
+  if (thread_mlfqs)
+    return;
+
   if(thread_current()->priority > thread_current()->priority_before_donation){
     thread_current()->priority_before_donation = new_priority;
   }
@@ -375,44 +743,77 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Changes T's effective priority to PRIORITY, moving T to the
+   matching run queue level if it is ready, or reordering the
+   semaphore or condition variable waiters it is in if it is
+   blocked.  Used by priority donation in synch.c. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_update_priority (struct thread *t, int priority)
 {
-  /* Not yet implemented. */
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  old_level = intr_disable ();
+  if (t->status == THREAD_READY && !is_idle_thread (t))
+    ready_queue_move (t, priority);
+  else if (t->priority != priority)
+    {
+      t->priority = priority;
+      if (t->status == THREAD_BLOCKED)
+        synch_priority_changed (t);
+    }
+  intr_set_level (old_level);
+}
+
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
+void
+thread_set_nice (int nice) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool yield;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  cur->priority = mlfqs_priority (cur);
+  yield = ready_bitmap != 0 && ready_queue_highest () > cur->priority;
+  intr_set_level (old_level);
+
+  if (yield)
+    thread_yield ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
-}
-
-/* Depends which thread has smaller time_to_wake_up */
-bool
-thread_wake_up_tick_is_smaller(const struct list_elem *first_elem, const struct list_elem *second_elem, void *aux)
-{
-  struct thread *first_thread = list_entry(first_elem, struct thread, elem);
-  struct thread *second_thread = list_entry(second_elem, struct thread, elem);
-  return first_thread->time_to_wake_up < second_thread->time_to_wake_up;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent_cpu_100;
 }
 
 /* Depends which thread has bigger priority */
@@ -430,9 +831,10 @@ thread_priority_is_bigger(const struct list_elem *first_elem, const struct list_
    thread_start().  It will be scheduled once initially, at which
    point it initializes idle_thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   blocks.  After that, the idle thread never
+   appears in the ready list.  It is returned by
+   next_thread_to_run() as a special case when the ready list is
+   empty. */
 static void
 idle (void *idle_started_ UNUSED) 
 {
@@ -444,8 +846,21 @@ idle (void *idle_started_ UNUSED)
     {
       /* Let someone else run. */
       intr_disable ();
+      timer_idle_exit ();
       thread_block ();
 
+      /* Nothing else to run.  Spend the time zeroing a page for
+         later PAL_ZERO requests, with interrupts on, then look
+         again for something to run. */
+      intr_enable ();
+      if (palloc_zero_idle ())
+        continue;
+      intr_disable ();
+
+      /* Still nothing to run.  Stop the periodic timer tick, if
+         tickless idle is enabled, until there is timer work. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -506,18 +921,33 @@ init_thread (struct thread *t, const char *name, int priority)
 
   memset (t, 0, sizeof *t);
   t->status = THREAD_BLOCKED;
+  t->stride_pass = stride_pass;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
+  if (thread_mlfqs)
+    {
+      /* Inherit niceness and recent_cpu from the creating thread,
+         and ignore the requested priority. */
+      if (t != initial_thread)
+        {
+          struct thread *parent = running_thread ();
+          t->nice = parent->nice;
+          t->recent_cpu = parent->recent_cpu;
+        }
+      t->mlfqs_second = mlfqs_seconds;
+      priority = mlfqs_priority (t);
+    }
   t->priority = priority;
   t->priority_before_donation = priority;
-  t->exit_once = true;
   sema_init(&t->wait, 0);
   sema_init(&t->wait2, 0);
+#ifdef USERPROG
+  t->exit_once = true;
   t->load_success = true;
   sema_init(&t->wait_load, 0);
-  list_init(&t->lock_list_which_thread_hold);
-  list_init(&t->lock_which_thread_waiting);
   list_init(&t->open_file_list);
+#endif
+  list_init(&t->lock_list_which_thread_hold);
   t->magic = THREAD_MAGIC;
   list_push_back (&all_list, &t->allelem);
 }
@@ -535,18 +965,402 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Returns a page for a new thread, from the thread page cache
+   if possible, otherwise freshly allocated and zeroed.  Returns
+   a null pointer if no page is available.  Only the struct
+   thread at the start of a cached page is initialized, by
+   init_thread(). */
+static struct thread *
+thread_page_get (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  spinlock_acquire (&thread_cache_lock);
+  if (!list_empty (&thread_cache))
+    {
+      t = list_entry (list_pop_front (&thread_cache), struct thread, allelem);
+      thread_cache_cnt--;
+      thread_cache_hits++;
+    }
+  else
+    thread_cache_misses++;
+  spinlock_release (&thread_cache_lock);
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (PAL_ZERO);
+  return t;
+}
+
+/* Frees the page of dead thread T, keeping it in the thread page
+   cache unless the cache already holds thread_cache_max pages.
+   Interrupts must be off. */
+static void
+thread_page_put (struct thread *t) 
+{
+  bool cached = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Make stale pointers to T fail is_thread(). */
+  t->magic = 0;
+
+  spinlock_acquire (&thread_cache_lock);
+  if (thread_cache_cnt < thread_cache_max)
+    {
+      list_push_front (&thread_cache, &t->allelem);
+      thread_cache_cnt++;
+      cached = true;
+    }
+  spinlock_release (&thread_cache_lock);
+
+  if (!cached)
+    palloc_free_page (t);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.  Interrupts must be off. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = ready_queue_pop ();
+  if (t == NULL)
     return idle_thread;
+  if (thread_stride && !is_edf_thread (t))
+    stride_pass = t->stride_pass;
+  return t;
+}
+
+/* Returns true if T is the idle thread. */
+static bool
+is_idle_thread (const struct thread *t) 
+{
+  return t == idle_thread;
+}
+
+/* Appends T to the back of the run queue for its priority.
+   Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (is_edf_thread (t))
+    heap_insert (&edf_queue, &t->edf_elem);
+  else if (thread_stride)
+    heap_insert (&stride_queue, &t->stride_elem);
+  else
+    {
+      list_push_back (&ready_queues[t->priority], &t->elem);
+      ready_bitmap |= (uint64_t) 1 << t->priority;
+    }
+  ready_cnt++;
+}
+
+/* Removes T from the run queue for its priority.  Interrupts
+   must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (is_edf_thread (t))
+    heap_remove (&edf_queue, &t->edf_elem);
+  else if (thread_stride)
+    heap_remove (&stride_queue, &t->stride_elem);
+  else
+    {
+      list_remove (&t->elem);
+      if (list_empty (&ready_queues[t->priority]))
+        ready_bitmap &= ~((uint64_t) 1 << t->priority);
+    }
+  ready_cnt--;
+}
+
+/* Removes and returns the thread that should run next from the
+   run queue: the EDF thread with the earliest deadline if there
+   is one, otherwise the first thread at the highest priority
+   level, or under the stride scheduler the thread with the
+   lowest pass.  Returns a null pointer if the run queue is
+   empty.  Takes O(1) time, or O(lg n) for EDF threads or under
+   the stride scheduler.  Interrupts must be off. */
+static struct thread *
+ready_queue_pop (void)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (ready_cnt == 0)
+    return NULL;
+  if (!heap_empty (&edf_queue))
+    t = heap_entry (heap_top (&edf_queue), struct thread, edf_elem);
+  else if (thread_stride)
+    t = heap_entry (heap_top (&stride_queue), struct thread, stride_elem);
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    t = list_entry (list_front (&ready_queues[ready_queue_highest ()]),
+                    struct thread, elem);
+  ready_queue_remove (t);
+  return t;
+}
+
+/* Sets the priority of ready thread T to PRIORITY, moving it to
+   the back of the matching run queue level if it changed.
+   Interrupts must be off. */
+static void
+ready_queue_move (struct thread *t, int priority)
+{
+  /* The stride and EDF run queues are not ordered by priority. */
+  if (thread_stride || is_edf_thread (t))
+    t->priority = priority;
+  else if (t->priority != priority)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t);
+    }
+}
+
+/* Returns the highest priority level with a nonempty run queue.
+   The run queue must not be empty.  Searches each 32-bit half of
+   ready_bitmap with a single BSR instruction; see [IA32-v2a]
+   "BSR". */
+static int
+ready_queue_highest (void)
+{
+  uint32_t high = ready_bitmap >> 32;
+  uint32_t low = ready_bitmap;
+  uint32_t bit;
+
+  ASSERT (ready_bitmap != 0);
+
+  if (high != 0)
+    {
+      asm ("bsrl %1, %0" : "=r" (bit) : "rm" (high));
+      return bit + 32;
+    }
+  asm ("bsrl %1, %0" : "=r" (bit) : "rm" (low));
+  return bit;
+}
+
+/* Returns true if the stride run queue element A should run
+   after B, that is, if A has the higher pass, so that the top of
+   the heap is the thread with the lowest pass. */
+static bool
+stride_less (const struct heap_elem *a, const struct heap_elem *b,
+             void *aux UNUSED)
+{
+  return (heap_entry (a, struct thread, stride_elem)->stride_pass
+          > heap_entry (b, struct thread, stride_elem)->stride_pass);
+}
+
+/* Returns the stride of T, inversely proportional to its
+   tickets, which are its priority plus 1. */
+static int
+stride_of (const struct thread *t)
+{
+  return STRIDE_ONE / (t->priority + 1);
+}
+
+/* Returns true if T belongs to the earliest-deadline-first
+   class. */
+static bool
+is_edf_thread (const struct thread *t)
+{
+  return t->edf_period != 0;
+}
+
+/* Returns the share of the CPU reserved by an EDF thread with
+   the given PERIOD, BUDGET, and relative DEADLINE, in units of
+   1 / EDF_DENSITY_ONE, rounded up. */
+static int64_t
+edf_density_of (int64_t period, int64_t budget, int64_t deadline)
+{
+  int64_t window = deadline < period ? deadline : period;
+
+  return (budget * EDF_DENSITY_ONE + (window - 1)) / window;
+}
+
+/* Returns true if EDF run queue element A should run after B,
+   that is, if A has the later deadline. */
+static bool
+edf_deadline_less (const struct heap_elem *a, const struct heap_elem *b,
+                   void *aux UNUSED)
+{
+  return (heap_entry (a, struct thread, edf_elem)->edf_deadline
+          > heap_entry (b, struct thread, edf_elem)->edf_deadline);
+}
+
+/* Returns true if EDF release heap element A is due after B. */
+static bool
+edf_release_less (const struct heap_elem *a, const struct heap_elem *b,
+                  void *aux UNUSED)
+{
+  return (heap_entry (a, struct thread, edf_elem)->edf_release
+          > heap_entry (b, struct thread, edf_elem)->edf_release);
+}
+
+/* Starts a new job for EDF thread T at time NOW, at or after its
+   release time: replenishes its budget and sets its deadline and
+   next release.  A thread released late, because it overran or
+   ended a job after the next release was due, restarts its
+   period from NOW rather than running back-to-back jobs to
+   catch up. */
+static void
+edf_start_job (struct thread *t, int64_t now)
+{
+  int64_t release = t->edf_release > now ? t->edf_release : now;
+
+  t->edf_remaining = t->edf_budget;
+  t->edf_throttled = false;
+  t->edf_deadline = release + t->edf_rel_deadline;
+  t->edf_release = release + t->edf_period;
+}
+
+/* Releases the waiting EDF threads whose release time is at or
+   before NOW, which is a timer tick.  A thread that was
+   throttled rather than waiting for its release missed its
+   deadline if the deadline has passed.  Runs in an external
+   interrupt context. */
+static void
+edf_release_due (int64_t now)
+{
+  while (!heap_empty (&edf_releases))
+    {
+      struct thread *t = heap_entry (heap_top (&edf_releases),
+                                     struct thread, edf_elem);
+
+      if (t->edf_release > now)
+        break;
+      heap_pop (&edf_releases);
+      if (t->edf_throttled && now >= t->edf_deadline)
+        t->edf_misses++;
+      edf_start_job (t, now);
+      thread_unblock (t);
+    }
+}
+
+/* Multi-level feedback queue scheduler work for timer tick,
+   with T the running thread.  Runs in an external interrupt
+   context. */
+static void
+mlfqs_tick (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  if (!is_idle_thread (t))
+    t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+  if (now % TIMER_FREQ == 0)
+    mlfqs_update_second ();
+
+  /* Between per-second updates, only the running thread's
+     recent_cpu changes, so it is the only thread whose priority
+     needs to be recomputed. */
+  if (now % 4 == 0 && !is_idle_thread (t))
+    t->priority = mlfqs_priority (t);
+  if (!is_edf_thread (t) && ready_bitmap != 0
+      && ready_queue_highest () > t->priority)
+    {
+      trace_event (TRACE_PREEMPT, t, 0);
+      intr_yield_on_return ();
+    }
+}
+
+/* Updates the load average and brings recent_cpu and priority
+   up to date for the running thread and every ready thread.
+   Blocked threads are brought up to date by thread_unblock().
+   Runs in an external interrupt context. */
+static void
+mlfqs_update_second (void)
+{
+  struct thread *cur = thread_current ();
+  int ready_threads = ready_cnt + (is_idle_thread (cur) ? 0 : 1);
+  fixed_t twice_load;
+  int pri;
+
+  load_avg = (59 * load_avg + fp_from_int (ready_threads)) / 60;
+  twice_load = 2 * load_avg;
+  decay_history[++mlfqs_seconds % MLFQS_HISTORY]
+    = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+  if (!is_idle_thread (cur))
+    {
+      mlfqs_catch_up (cur);
+      cur->priority = mlfqs_priority (cur);
+    }
+
+  /* A thread whose priority changes moves to another level, so
+     save the next element before refreshing.  If the move is to
+     a level not yet visited, mlfqs_catch_up() finds it already
+     up to date when we get there. */
+  for (pri = PRI_MAX; pri >= PRI_MIN; pri--)
+    {
+      struct list_elem *e, *next;
+
+      if ((ready_bitmap & ((uint64_t) 1 << pri)) == 0)
+        continue;
+      for (e = list_begin (&ready_queues[pri]);
+           e != list_end (&ready_queues[pri]); e = next)
+        {
+          struct thread *t = list_entry (e, struct thread, elem);
+
+          next = list_next (e);
+          if (t->mlfqs_second != mlfqs_seconds)
+            {
+              mlfqs_catch_up (t);
+              ready_queue_move (t, mlfqs_priority (t));
+            }
+        }
+    }
+}
+
+/* Replays the recent_cpu decays that T missed since it was last
+   brought up to date.  The caller recomputes T's priority.
+   Interrupts must be off. */
+static void
+mlfqs_catch_up (struct thread *t)
+{
+  int64_t missed = mlfqs_seconds - t->mlfqs_second;
+  int64_t s;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (missed == 0)
+    return;
+  if (missed > MLFQS_HISTORY)
+    {
+      t->recent_cpu = 0;
+      missed = MLFQS_HISTORY;
+    }
+  for (s = mlfqs_seconds - missed + 1; s <= mlfqs_seconds; s++)
+    t->recent_cpu = fp_add_int (fp_mul (decay_history[s % MLFQS_HISTORY],
+                                        t->recent_cpu), t->nice);
+  t->mlfqs_second = mlfqs_seconds;
+}
+
+/* Returns the priority that the MLFQS formula assigns to T,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the
+   valid range. */
+static int
+mlfqs_priority (const struct thread *t)
+{
+  int priority = PRI_MAX - fp_to_int (t->recent_cpu / 4) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -554,10 +1368,10 @@ next_thread_to_run (void)
 
    At this function's invocation, we just switched from thread
    PREV, the new thread is already running, and interrupts are
-   still disabled.  This function is normally invoked by
-   thread_schedule() as its final action before returning, but
-   the first time a thread is scheduled it is called by
-   switch_entry() (see switch.S).
+   still disabled.  This function is
+   normally invoked by thread_schedule() as its final action
+   before returning, but the first time a thread is scheduled it
+   is called by switch_entry() (see switch.S).
 
    It's not safe to call printf() until the thread switch is
    complete.  In practice that means that printf()s should be
@@ -591,7 +1405,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
@@ -614,7 +1428,15 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* Being throttled by the EDF class counts as preemption. */
+      if (cur->status == THREAD_READY || cur->edf_throttled)
+        cur->usage.involuntary_switches++;
+      else if (cur->status == THREAD_BLOCKED)
+        cur->usage.voluntary_switches++;
+      trace_event (TRACE_SWITCH, next, cur->tid);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -632,20 +1454,55 @@ allocate_tid (void)
   return tid;
 }
 
+/* Adds T, whose tid must already be assigned, to the tid index. */
+static void
+tid_index_insert (struct thread *t) 
+{
+  lock_acquire (&tid_index_lock);
+  hash_insert (&tid_index, &t->tid_elem);
+  lock_release (&tid_index_lock);
+}
+
+/* Returns the tid of E, which is either the struct tid_key that
+   KEY points to or embedded in a thread. */
+static tid_t
+tid_index_elem_tid (const struct hash_elem *e, void *key_) 
+{
+  struct tid_key *key = key_;
+
+  if (e == &key->elem)
+    return key->tid;
+  return hash_entry (e, struct thread, tid_elem)->tid;
+}
+
+/* Returns a hash value for E's tid. */
+static unsigned
+tid_index_hash (const struct hash_elem *e, void *key) 
+{
+  return hash_int (tid_index_elem_tid (e, key));
+}
+
+/* Returns true if A's tid precedes B's. */
+static bool
+tid_index_less (const struct hash_elem *a, const struct hash_elem *b,
+                void *key) 
+{
+  return tid_index_elem_tid (a, key) < tid_index_elem_tid (b, key);
+}
+
+/* Returns the live thread whose tid is INPUT_TID, or a null
+   pointer if there is none, either because INPUT_TID was never
+   allocated or because that thread has already exited.  Takes
+   O(1) expected time. */
 struct thread *
 find_thread_using_tid(tid_t input_tid) {
-  struct list_elem *e;
+  struct hash_elem *e;
 
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
-    {
-
-      struct thread *t = list_entry (e, struct thread, allelem);
-      if(t->tid == input_tid){
-        return t;
-      }
-    }
-    return NULL;
+  lock_acquire (&tid_index_lock);
+  tid_key.tid = input_tid;
+  e = hash_find (&tid_index, &tid_key.elem);
+  lock_release (&tid_index_lock);
+  return e != NULL ? hash_entry (e, struct thread, tid_elem) : NULL;
 }
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
@@ -4,6 +4,9 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <fixed-point.h>
+#include <rusage.h>
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "filesys/filesys.h"
 #include "lib/kernel/hash.h"
@@ -26,6 +29,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -76,12 +84,10 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread blocked on a semaphore is in the semaphore's waiters
+   heap through `sema_elem' instead (synch.c), so that donation
+   can reorder the heap when the thread's priority changes. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -91,6 +97,8 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct hash_elem tid_elem;          /* Hash element for tid index. */
+    struct rusage usage;                /* Resources used so far. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
@@ -114,6 +122,8 @@ struct thread
 
     struct list open_file_list;
     struct file * exec_file;
+
+    struct rusage child_usage;          /* Usage of waited-for children. */
 #endif
 
 #ifdef VM
@@ -121,7 +131,8 @@ struct thread
 #endif
 
     /* Used in devices/timer.c -> timer_sleep() */
-    int64_t time_to_wake_up;            /* Store time ticks which thread must wake up */
+    int64_t time_to_wake_up;            /* Tick to wake up at, 0 if not sleeping */
+    struct list_elem timer_elem;        /* Timing wheel slot list element */
 
     /* Used in synch.c */
     int priority_before_donation;       /* Store it's undonated priority */
@@ -130,7 +141,35 @@ struct thread
     struct list lock_list_which_thread_hold; /* store lock list which thread is owning */
 
     /* Used in synch.c */
-    struct list lock_which_thread_waiting; /* store lock's list which thread is waiting */
+    struct lock *waiting_on;            /* Lock it is blocked on, if any */
+    struct heap_elem sema_elem;         /* Semaphore waiters heap element */
+    struct semaphore *waiting_sema;     /* Semaphore it is blocked on, if any */
+    struct condition *waiting_cond;     /* Condition it waits on, if any */
+    struct heap_elem *cond_elem;        /* Its element in waiting_cond's heap */
+
+    /* Used by the multi-level feedback queue scheduler. */
+    int nice;                           /* Niceness, -20 to 20. */
+    fixed_t recent_cpu;                 /* Recent CPU time received. */
+    int64_t mlfqs_second;               /* Second recent_cpu is current as of. */
+
+    /* Used by the stride scheduler. */
+    int64_t stride_pass;                /* Pass value. */
+    struct heap_elem stride_elem;       /* Stride run queue element. */
+
+    /* Used by the earliest-deadline-first class.  All times are
+       in timer ticks. */
+    int64_t edf_period;                 /* Period, 0 if not EDF. */
+    int64_t edf_budget;                 /* CPU time per period. */
+    int64_t edf_rel_deadline;           /* Deadline after each release. */
+    int64_t edf_deadline;               /* Current job's deadline. */
+    int64_t edf_release;                /* Next job's release time. */
+    int64_t edf_remaining;              /* Budget left in current job. */
+    bool edf_throttled;                 /* Out of budget until release. */
+    unsigned edf_misses;                /* # of jobs late for deadline. */
+    struct heap_elem edf_elem;          /* EDF run queue or release heap. */
+
+    /* Owned by threads/malloc.c. */
+    struct malloc_magazine malloc_mags[MALLOC_CLASSES]; /* Free blocks. */
     
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -141,14 +180,29 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride (proportional-share) scheduler.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* Maximum number of dead threads' pages kept for reuse by
+   thread_create().  Controlled by kernel command-line option
+   "-tcache=N". */
+extern unsigned thread_cache_max;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_account_idle (int);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_edf (const char *name, int64_t period, int64_t budget,
+                         int64_t deadline, thread_func *, void *);
+void thread_edf_wait (void);
+unsigned thread_get_deadline_misses (void);
+int64_t thread_edf_next_release (void);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -166,15 +220,13 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *, int);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-/* Depends which thread has smaller time_to_wake_up */
-bool thread_wake_up_tick_is_smaller(const struct list_elem *, const struct list_elem *, void *);
-
 /* Depends which thread has bigger priority */
 bool thread_priority_is_bigger(const struct list_elem *, const struct list_elem *, void *);
 
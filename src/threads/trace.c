@@ -0,0 +1,138 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <packed.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+
+/* If true, record trace events.  Controlled by kernel
+   command-line option "-trace". */
+bool trace_enabled;
+
+/* A trace event, as stored in the ring and in the dump. */
+struct trace_entry
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    int32_t tid;                /* Thread the event is about. */
+    int32_t arg;                /* Type-specific argument. */
+    uint8_t type;               /* An enum trace_type. */
+    uint8_t priority;           /* Thread's priority at the time. */
+    uint16_t reserved;          /* Always zero. */
+  }
+PACKED;
+
+/* Header of a trace dump, in the first sector of the scratch
+   device.  Events follow, packed, starting at the next sector.
+   All fields are little-endian. */
+struct trace_header
+  {
+    char magic[8];              /* TRACE_MAGIC. */
+    uint32_t entry_cnt;         /* Number of events that follow. */
+    uint32_t entry_size;        /* sizeof (struct trace_entry). */
+    uint32_t dropped;           /* Events overwritten before dump. */
+    uint32_t reserved;          /* Always zero. */
+    uint64_t tsc_hz;            /* Time-stamp counter frequency. */
+  }
+PACKED;
+
+#define TRACE_MAGIC "PTRACE01"
+
+/* Ring of the most recent TRACE_SIZE events.  trace_head counts
+   every event ever recorded, and the next event goes into slot
+   trace_head % TRACE_SIZE.  A writer claims its slot with a
+   single atomic increment, so recording takes no lock and may
+   happen in an interrupt handler. */
+#define TRACE_SIZE 4096                 /* Must be a power of 2. */
+static struct trace_entry trace_ring[TRACE_SIZE];
+static uint32_t trace_head;
+
+/* Records an event of the given TYPE for thread T with argument
+   ARG.  Use trace_event() instead, which checks trace_enabled
+   first. */
+void
+trace_record (enum trace_type type, const struct thread *t, int arg)
+{
+  uint32_t slot = 1;
+  struct trace_entry *e;
+
+  /* Claim a slot.  See [IA32-v2b] "XADD". */
+  asm volatile ("lock xaddl %0, %1" : "+r" (slot), "+m" (trace_head)
+                : : "memory");
+
+  e = &trace_ring[slot % TRACE_SIZE];
+  e->tsc = timer_rdtsc ();
+  e->tid = t->tid;
+  e->arg = arg;
+  e->type = type;
+  e->priority = t->priority;
+  e->reserved = 0;
+}
+
+/* Stops tracing and writes the trace ring, oldest event first,
+   to the start of the scratch device.  Implements the
+   "tracedump" kernel command-line action. */
+void
+trace_dump (char **argv UNUSED)
+{
+  static uint8_t buffer[BLOCK_SECTOR_SIZE];
+  struct trace_header *h = (struct trace_header *) buffer;
+  struct block *dst;
+  block_sector_t sector = 0;
+  uint32_t head, first, i;
+  size_t ofs;
+
+  trace_enabled = false;
+  barrier ();
+  head = trace_head;
+  first = head > TRACE_SIZE ? head - TRACE_SIZE : 0;
+
+  printf ("Dumping %"PRIu32" trace events to scratch device...\n",
+          head - first);
+  dst = block_get_role (BLOCK_SCRATCH);
+  if (dst == NULL)
+    PANIC ("couldn't open scratch device");
+  if (1 + DIV_ROUND_UP ((head - first) * sizeof *trace_ring,
+                        BLOCK_SECTOR_SIZE) > block_size (dst))
+    PANIC ("trace: out of space on scratch device");
+
+  memset (buffer, 0, sizeof buffer);
+  memcpy (h->magic, TRACE_MAGIC, sizeof h->magic);
+  h->entry_cnt = head - first;
+  h->entry_size = sizeof *trace_ring;
+  h->dropped = first;
+  h->tsc_hz = timer_tsc_hz ();
+  block_write (dst, sector++, buffer);
+
+  /* Pack events into sectors, letting them straddle sector
+     boundaries. */
+  ofs = 0;
+  memset (buffer, 0, sizeof buffer);
+  for (i = first; i != head; i++)
+    {
+      const uint8_t *src = (const uint8_t *) &trace_ring[i % TRACE_SIZE];
+      size_t left = sizeof *trace_ring;
+
+      while (left > 0)
+        {
+          size_t chunk = BLOCK_SECTOR_SIZE - ofs;
+          if (chunk > left)
+            chunk = left;
+          memcpy (buffer + ofs, src, chunk);
+          src += chunk;
+          left -= chunk;
+          ofs += chunk;
+          if (ofs == BLOCK_SECTOR_SIZE)
+            {
+              block_write (dst, sector++, buffer);
+              memset (buffer, 0, sizeof buffer);
+              ofs = 0;
+            }
+        }
+    }
+  if (ofs > 0)
+    block_write (dst, sector++, buffer);
+}
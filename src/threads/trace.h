@@ -0,0 +1,42 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Scheduler trace.
+
+   When enabled with the "-trace" kernel command-line option,
+   the scheduler and synchronization primitives record events in
+   a fixed-size ring buffer, each stamped with the time-stamp
+   counter.  The "tracedump" action writes the ring to the
+   scratch device, and utils/pintos-trace decodes it on the
+   host. */
+
+/* Trace event types.  The values are part of the dump format. */
+enum trace_type
+  {
+    TRACE_SWITCH = 1,           /* TID switched in; ARG is previous tid. */
+    TRACE_WAKEUP = 2,           /* TID unblocked; ARG is waker's tid. */
+    TRACE_BLOCK = 3,            /* TID blocked. */
+    TRACE_YIELD = 4,            /* TID yielded and is ready. */
+    TRACE_PREEMPT = 5,          /* TID must yield to ARG (0 if end of slice). */
+    TRACE_DONATE = 6            /* TID received priority ARG. */
+  };
+
+extern bool trace_enabled;
+
+void trace_record (enum trace_type, const struct thread *, int arg);
+void trace_dump (char **argv);
+
+/* Records an event of the given TYPE for thread T with argument
+   ARG, if tracing is enabled. */
+static inline void
+trace_event (enum trace_type type, const struct thread *t, int arg)
+{
+  if (trace_enabled)
+    trace_record (type, t, arg);
+}
+
+#endif /* threads/trace.h */
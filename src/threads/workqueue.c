@@ -0,0 +1,334 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Delayed work for all queues, in no particular order, and the
+   earliest time at which any of it expires, or INT64_MAX if
+   there is none.  workqueue_tick() only scans the list once that
+   time comes, so most ticks cost a single comparison.  Protected
+   by delayed_lock.
+
+   A work item's `pending' and `delayed' members are protected by
+   disabling interrupts. */
+static struct list delayed_list;
+static struct spinlock delayed_lock;
+static int64_t next_expiry = INT64_MAX;
+
+/* A thread waiting in workqueue_flush(). */
+struct flusher
+  {
+    struct list_elem elem;      /* Element in workqueue's `flushers'. */
+    struct semaphore done;      /* Upped when the queue is idle. */
+  };
+
+static thread_func worker;
+static void enqueue (struct workqueue *, struct work *);
+static void take_flushers (struct workqueue *, struct list *);
+static void wake_flushers (struct list *);
+
+/* Initializes the delayed work list.  Must be called before
+   any work is queued. */
+void
+workqueue_init (void) 
+{
+  list_init (&delayed_list);
+  spinlock_init (&delayed_lock);
+}
+
+/* Initializes WQ, named NAME, and starts THREAD_CNT worker
+   threads for it at the given PRIORITY.  NAME must remain valid
+   as long as WQ does.  Returns true if successful, false if a
+   worker thread could not be created. */
+bool
+workqueue_create (struct workqueue *wq, const char *name,
+                  int thread_cnt, int priority) 
+{
+  int i;
+
+  ASSERT (thread_cnt > 0);
+
+  wq->name = name;
+  spinlock_init (&wq->lock);
+  list_init (&wq->pending);
+  wq->running = 0;
+  list_init (&wq->flushers);
+  sema_init (&wq->work_sema, 0);
+
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+      if (thread_create (thread_name, priority, worker, wq) == TID_ERROR)
+        return false;
+    }
+  return true;
+}
+
+/* Waits until WQ has no work pending or running.  Delayed work
+   that has not expired yet is not waited for.  Must not be
+   called from one of WQ's own work functions, which would wait
+   for itself. */
+void
+workqueue_flush (struct workqueue *wq) 
+{
+  struct flusher f;
+  enum intr_level old_level;
+  bool idle;
+
+  ASSERT (!intr_context ());
+
+  sema_init (&f.done, 0);
+  old_level = intr_disable ();
+  spinlock_acquire (&wq->lock);
+  idle = list_empty (&wq->pending) && wq->running == 0;
+  if (!idle)
+    list_push_back (&wq->flushers, &f.elem);
+  spinlock_release (&wq->lock);
+  intr_set_level (old_level);
+
+  if (!idle)
+    sema_down (&f.done);
+}
+
+/* Initializes W to run FUNC, which may use AUX as it likes. */
+void
+work_init (struct work *w, work_func *func, void *aux) 
+{
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->wq = NULL;
+  w->expires = 0;
+  w->pending = false;
+  w->delayed = false;
+}
+
+/* Queues W to run on WQ.  Returns true if successful, false if
+   W was already pending.  May be called from an interrupt
+   handler. */
+bool
+queue_work (struct workqueue *wq, struct work *w) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      enqueue (wq, w);
+      queued = true;
+    }
+  intr_set_level (old_level);
+  return queued;
+}
+
+/* Queues W to run on WQ after TICKS timer ticks, or at once if
+   TICKS is not positive.  Returns true if successful, false if
+   W was already pending.  May be called from an interrupt
+   handler. */
+bool
+queue_delayed_work (struct workqueue *wq, struct work *w, int64_t ticks) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  if (ticks <= 0)
+    return queue_work (wq, w);
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      w->pending = w->delayed = true;
+      w->wq = wq;
+      w->expires = timer_ticks () + ticks;
+
+      spinlock_acquire (&delayed_lock);
+      list_push_back (&delayed_list, &w->elem);
+      if (w->expires < next_expiry)
+        next_expiry = w->expires;
+      spinlock_release (&delayed_lock);
+      queued = true;
+    }
+  intr_set_level (old_level);
+  return queued;
+}
+
+/* Removes W from its queue if it is pending, so that it will
+   not run, and returns true.  Returns false if W was not
+   pending, in which case it may be running now.  May be called
+   from an interrupt handler. */
+bool
+cancel_work (struct work *w) 
+{
+  struct list flushers;
+  enum intr_level old_level;
+  bool cancelled = false;
+
+  list_init (&flushers);
+  old_level = intr_disable ();
+  if (w->pending && w->delayed)
+    {
+      /* next_expiry may now be early, which is harmless. */
+      spinlock_acquire (&delayed_lock);
+      list_remove (&w->elem);
+      spinlock_release (&delayed_lock);
+      cancelled = true;
+    }
+  else if (w->pending)
+    {
+      /* The worker that downs work_sema for W finds nothing to
+         do. */
+      spinlock_acquire (&w->wq->lock);
+      list_remove (&w->elem);
+      take_flushers (w->wq, &flushers);
+      spinlock_release (&w->wq->lock);
+      cancelled = true;
+    }
+  w->pending = w->delayed = false;
+  wake_flushers (&flushers);
+  intr_set_level (old_level);
+  return cancelled;
+}
+
+/* Moves delayed work that expires at or before NOW, which is a
+   timer tick, to its queue.  Called from the timer interrupt
+   handler at each tick. */
+void
+workqueue_tick (int64_t now) 
+{
+  struct list expired;
+  struct list_elem *e, *next;
+
+  if (now < next_expiry)
+    return;
+
+  list_init (&expired);
+  spinlock_acquire (&delayed_lock);
+  next_expiry = INT64_MAX;
+  for (e = list_begin (&delayed_list); e != list_end (&delayed_list);
+       e = next)
+    {
+      struct work *w = list_entry (e, struct work, elem);
+
+      next = list_next (e);
+      if (w->expires <= now)
+        {
+          list_remove (e);
+          list_push_back (&expired, e);
+        }
+      else if (w->expires < next_expiry)
+        next_expiry = w->expires;
+    }
+  spinlock_release (&delayed_lock);
+
+  while (!list_empty (&expired))
+    {
+      struct work *w = list_entry (list_pop_front (&expired),
+                                   struct work, elem);
+      w->delayed = false;
+      enqueue (w->wq, w);
+    }
+}
+
+/* Returns the earliest tick at which delayed work expires, or
+   INT64_MAX if there is none.  Used by tickless idle in
+   devices/timer.c.  Interrupts must be off. */
+int64_t
+workqueue_next_expiry (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return next_expiry;
+}
+
+/* Worker thread for workqueue WQ_: runs WQ_'s pending work, in
+   order, forever. */
+static void
+worker (void *wq_) 
+{
+  struct workqueue *wq = wq_;
+
+  for (;;) 
+    {
+      struct work *w = NULL;
+      struct list flushers;
+      enum intr_level old_level;
+
+      sema_down (&wq->work_sema);
+
+      old_level = intr_disable ();
+      spinlock_acquire (&wq->lock);
+      if (!list_empty (&wq->pending))
+        {
+          w = list_entry (list_pop_front (&wq->pending), struct work, elem);
+          w->pending = false;
+          wq->running++;
+        }
+      spinlock_release (&wq->lock);
+      intr_set_level (old_level);
+
+      /* W was cancelled. */
+      if (w == NULL)
+        continue;
+
+      /* W may be freed or queued again as soon as its function
+         starts, so don't touch it afterward. */
+      w->func (w);
+
+      list_init (&flushers);
+      old_level = intr_disable ();
+      spinlock_acquire (&wq->lock);
+      wq->running--;
+      take_flushers (wq, &flushers);
+      spinlock_release (&wq->lock);
+      wake_flushers (&flushers);
+      intr_set_level (old_level);
+    }
+}
+
+/* Appends W, which must not be pending, to WQ's pending list and
+   wakes a worker.  Interrupts must be off. */
+static void
+enqueue (struct workqueue *wq, struct work *w) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  w->pending = true;
+  w->wq = wq;
+  spinlock_acquire (&wq->lock);
+  list_push_back (&wq->pending, &w->elem);
+  spinlock_release (&wq->lock);
+  sema_up (&wq->work_sema);
+}
+
+/* If WQ is idle, moves its flushers to list FLUSHERS, to be
+   woken by wake_flushers() once WQ's lock is released.  WQ's
+   lock must be held. */
+static void
+take_flushers (struct workqueue *wq, struct list *flushers) 
+{
+  ASSERT (spinlock_held (&wq->lock));
+
+  if (list_empty (&wq->pending) && wq->running == 0)
+    while (!list_empty (&wq->flushers))
+      list_push_back (flushers, list_pop_front (&wq->flushers));
+}
+
+/* Wakes up each flusher in FLUSHERS. */
+static void
+wake_flushers (struct list *flushers) 
+{
+  while (!list_empty (flushers))
+    {
+      /* The flusher's struct is on its stack, so it may vanish
+         as soon as it is woken. */
+      struct flusher *f = list_entry (list_pop_front (flushers),
+                                      struct flusher, elem);
+      sema_up (&f->done);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Workqueues.
+
+   A workqueue runs functions on behalf of other code in a pool
+   of kernel threads, so that an interrupt handler can hand off
+   work that takes too long to do with interrupts off, or that
+   needs to sleep.  queue_work() and queue_delayed_work() take
+   O(1) time and may be called from an interrupt handler.
+
+   A work item is embedded in the caller's own structure, like a
+   list_elem, and work_func receives a pointer to it; use
+   list_entry()-style pointer arithmetic, or the work's AUX, to
+   get back to the containing structure.  A work item can be
+   pending on at most one queue at a time.  Once its function
+   starts running it is no longer pending, so it may queue itself
+   again.
+
+   There is no shared queue.  Each subsystem that defers work
+   creates its own with workqueue_create(), so that kernels
+   whose drivers defer nothing start no worker threads. */
+
+struct work;
+typedef void work_func (struct work *);
+
+/* A unit of deferred work. */
+struct work
+  {
+    struct list_elem elem;      /* Pending or delayed list element. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* For the function's use. */
+    struct workqueue *wq;       /* Queue it is pending on, if any. */
+    int64_t expires;            /* Tick to queue at, if delayed. */
+    bool pending;               /* Queued or delayed, not yet run. */
+    bool delayed;               /* On the delayed list. */
+  };
+
+/* A queue of work and the threads that run it. */
+struct workqueue
+  {
+    const char *name;           /* Name, for worker threads. */
+    struct spinlock lock;       /* Protects the members below. */
+    struct list pending;        /* Work waiting to run. */
+    int running;                /* # of work items running now. */
+    struct list flushers;       /* Threads in workqueue_flush(). */
+    struct semaphore work_sema; /* Counts pending work. */
+  };
+
+void workqueue_init (void);
+bool workqueue_create (struct workqueue *, const char *name,
+                       int thread_cnt, int priority);
+void workqueue_flush (struct workqueue *);
+
+void work_init (struct work *, work_func *, void *aux);
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct work *, int64_t ticks);
+bool cancel_work (struct work *);
+
+void workqueue_tick (int64_t now);
+int64_t workqueue_next_expiry (void);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,193 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "devices/timer.h"
+
+/* Fast user-space mutexes.
+
+   A user program waits in futex_wait() for the int at a user
+   address to change from a value it expects, and another
+   program wakes it with futex_wake() after changing the int.
+   Waiters are keyed by the kernel virtual address that the user
+   address maps to, which identifies the physical frame and the
+   offset within it, so that two processes that mapped the same
+   frame at different user addresses would meet.  This tree has
+   no shared mappings, though, and each process has a single
+   thread, so for now a waiter can only be woken by its timeout.
+
+   Waiters sit in a hash table of FUTEX_BUCKETS lists, in FIFO
+   order.  The table is protected by disabling interrupts,
+   because a waiter's timeout expires in the timer interrupt. */
+#define FUTEX_BUCKETS 64
+
+static struct list buckets[FUTEX_BUCKETS];
+
+/* A thread waiting in futex_wait(). */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in a bucket. */
+    uintptr_t key;              /* Kernel address waited on. */
+    struct thread *thread;      /* Waiting thread. */
+    bool queued;                /* In its bucket? */
+    bool timed;                 /* Has a timeout? */
+    bool woken;                 /* Woken by futex_wake()? */
+  };
+
+static uintptr_t futex_key (const int *uaddr);
+static struct list *futex_bucket (uintptr_t key);
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) 
+{
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    list_init (&buckets[i]);
+}
+
+/* If the int at user address UADDR equals EXPECTED, sleeps until
+   woken by futex_wake() on the same int or until TIMEOUT_MS
+   milliseconds pass, and returns FUTEX_WOKEN or FUTEX_TIMEDOUT.
+   A negative TIMEOUT_MS, such as FUTEX_FOREVER, never times out.
+   Returns FUTEX_AGAIN at once if the int does not equal
+   EXPECTED.
+
+   The comparison and going to sleep are atomic with respect to
+   futex_wake(), so a wake-up that follows a change to the int
+   cannot be lost.  UADDR must be valid, aligned, and its page
+   present, which the caller ensures by checking and reading it
+   first. */
+int
+futex_wait (const int *uaddr, int expected, int timeout_ms) 
+{
+  struct futex_waiter w;
+  enum intr_level old_level;
+  int64_t ticks = 0;
+  int result;
+
+  ASSERT (!intr_context ());
+  ASSERT ((uintptr_t) uaddr % sizeof *uaddr == 0);
+
+  if (timeout_ms >= 0)
+    {
+      ticks = DIV_ROUND_UP ((int64_t) timeout_ms * TIMER_FREQ, 1000);
+      if (ticks == 0)
+        ticks = 1;
+    }
+
+  old_level = intr_disable ();
+  w.key = futex_key (uaddr);
+
+  /* The page may have been evicted since the caller touched it.
+     Returning FUTEX_AGAIN makes the caller check and retry. */
+  if (w.key == 0 || *(const int *) w.key != expected)
+    {
+      intr_set_level (old_level);
+      return FUTEX_AGAIN;
+    }
+
+  w.thread = thread_current ();
+  w.queued = true;
+  w.timed = timeout_ms >= 0;
+  w.woken = false;
+  list_push_back (futex_bucket (w.key), &w.elem);
+  if (w.timed)
+    timer_set_timeout (ticks);
+  thread_block ();
+
+  /* If the timeout woke us, we may still be queued. */
+  if (w.queued)
+    list_remove (&w.elem);
+  result = w.woken ? FUTEX_WOKEN : FUTEX_TIMEDOUT;
+  intr_set_level (old_level);
+
+  return result;
+}
+
+/* Wakes up to CNT threads waiting in futex_wait() on the int at
+   user address UADDR, oldest first, and returns the number
+   woken.  UADDR must be valid, aligned, and its page present. */
+int
+futex_wake (const int *uaddr, int cnt) 
+{
+  enum intr_level old_level;
+  struct list *bucket;
+  struct list_elem *e, *next;
+  struct list wake_list;
+  uintptr_t key;
+  int woken = 0;
+
+  ASSERT ((uintptr_t) uaddr % sizeof *uaddr == 0);
+
+  old_level = intr_disable ();
+  key = futex_key (uaddr);
+  if (key == 0)
+    {
+      intr_set_level (old_level);
+      return 0;
+    }
+
+  /* Take the waiters to wake off the bucket first.  Unblocking
+     one may yield to it, and while we are switched out, a waiter
+     that has timed out can return from futex_wait(), which frees
+     its struct futex_waiter, so we must not walk the bucket
+     across thread_unblock().  The waiters left in WAKE_LIST stay
+     blocked, and so valid, until we unblock them. */
+  list_init (&wake_list);
+  bucket = futex_bucket (key);
+  for (e = list_begin (bucket); e != list_end (bucket) && woken < cnt;
+       e = next)
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+      next = list_next (e);
+      if (w->key != key)
+        continue;
+
+      list_remove (&w->elem);
+      w->queued = false;
+
+      /* A waiter whose timeout already expired has been unblocked
+         by the timer, so it doesn't count. */
+      if (w->timed && !timer_cancel (w->thread))
+        continue;
+      w->woken = true;
+      list_push_back (&wake_list, &w->elem);
+      woken++;
+    }
+
+  while (!list_empty (&wake_list))
+    {
+      e = list_pop_front (&wake_list);
+      thread_unblock (list_entry (e, struct futex_waiter, elem)->thread);
+    }
+  intr_set_level (old_level);
+
+  return woken;
+}
+
+/* Returns the kernel virtual address that user address UADDR
+   maps to in the current process, or 0 if its page is not
+   present.  Interrupts must be off, so that the page cannot be
+   evicted before the key is used. */
+static uintptr_t
+futex_key (const int *uaddr) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return (uintptr_t) pagedir_get_page (thread_current ()->pagedir, uaddr);
+}
+
+/* Returns the wait queue bucket for KEY.  Futexes are ints, so
+   the low 2 bits of a key carry little information. */
+static struct list *
+futex_bucket (uintptr_t key) 
+{
+  return &buckets[(key >> 2) % FUTEX_BUCKETS];
+}
@@ -0,0 +1,10 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <futex.h>
+
+void futex_init (void);
+int futex_wait (const int *uaddr, int expected, int timeout_ms);
+int futex_wake (const int *uaddr, int cnt);
+
+#endif /* userprog/futex.h */
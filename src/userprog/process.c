@@ -26,6 +26,7 @@
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static void rusage_add (struct rusage *, const struct rusage *);
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -66,12 +67,16 @@ process_execute (const char *file_name)
   }
   else {
     struct thread * new = find_thread_using_tid(tid);
-    sema_down(&find_thread_using_tid(tid)->wait_load);
+    if(new == NULL){
+      palloc_free_page(file_name_);
+      return -1;
+    }
+    sema_down(&new->wait_load);
     if(new->load_success == false){
       palloc_free_page(file_name_);
       return -1;
     }
-    find_thread_using_tid(tid)->parent_thread = thread_current();
+    new->parent_thread = thread_current();
   }
   palloc_free_page(file_name_);
   return tid;
@@ -176,8 +181,8 @@ start_process (void *file_name_)
    been successfully called for the given TID, returns -1
    immediately, without waiting.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   The child's resource usage, and that of its own waited-for
+   children, is added to the caller's child_usage. */
 int
 process_wait (tid_t child_tid) 
 {
@@ -192,12 +197,25 @@ process_wait (tid_t child_tid)
   if(t->exit_once == false)
     return -1;
   sema_down(&t->wait);
+  rusage_add (&thread_current ()->child_usage, &t->usage);
+  rusage_add (&thread_current ()->child_usage, &t->child_usage);
   int exit_status = t->exit_status;
   t->exit_once = false;
   sema_up(&t->wait2);
   return exit_status;
 }
 
+/* Adds the counts in B to A. */
+static void
+rusage_add (struct rusage *a, const struct rusage *b)
+{
+  a->user_ticks += b->user_ticks;
+  a->kernel_ticks += b->kernel_ticks;
+  a->voluntary_switches += b->voluntary_switches;
+  a->involuntary_switches += b->involuntary_switches;
+  a->page_faults += b->page_faults;
+}
+
 /* Free the current process's resources. */
 void
 process_exit (void)
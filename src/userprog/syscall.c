@@ -2,25 +2,34 @@
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/memstat.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "userprog/process.h"
 #include "devices/shutdown.h"
 #include "threads/synch.h"
 #include "filesys/filesys.h"
+#include "userprog/futex.h"
 
 static void syscall_handler (struct intr_frame *);
 
 static struct lock syscall_lock;
 static struct lock fd_lock;
 
+/* Cache of struct file_descriptor. */
+static struct kmem_cache fd_cache;
+
 
 void
 syscall_init (void) 
 {
   lock_init(&syscall_lock);
   lock_init(&fd_lock);
+  kmem_cache_init(&fd_cache, "file_descriptor",
+                  sizeof (struct file_descriptor), NULL);
+  futex_init();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -61,6 +70,17 @@ put_user (uint8_t *udst, uint8_t byte)
   return -1;
 }
 
+static void
+put_user_many(uint8_t *start, int how_many, const void *source){
+  int cnt;
+
+  for(cnt=0; cnt<how_many; cnt++){
+    if(!is_user_vaddr(start+cnt) || !put_user(start+cnt, *((const uint8_t *)source + cnt))){
+      our_exit(-1);
+    }
+  }
+}
+
 int
 allocate_fd (void) 
 {
@@ -168,8 +188,9 @@ our_open(const char * file){
     lock_release(&syscall_lock);
     return -1;
   }
-  file_desc = palloc_get_page(0);
+  file_desc = kmem_cache_alloc(&fd_cache);
   if(file_desc == NULL){
+    file_close(file_opened);
     lock_release(&syscall_lock);
     return -1;
   }
@@ -272,11 +293,56 @@ our_close(int fd)
     lock_acquire(&syscall_lock);
     file_close(file_opened);
     list_remove(&descriptor->elem);
-    palloc_free_page(descriptor);
+    kmem_cache_free(&fd_cache, descriptor);
     lock_release(&syscall_lock);
   }
 }
 
+/* Kills the process unless ADDR is a valid user address of an
+   aligned int, and faults in its page.  An int that straddled a
+   page boundary would be compared through the kernel alias of
+   its first page only. */
+static void
+check_futex_addr(const int *addr){
+  int value;
+
+  if((uintptr_t)addr % sizeof(int) != 0)
+    our_exit(-1);
+  get_user_many((const uint8_t *)addr, 4, &value);
+}
+
+static bool
+our_getrusage(int who, struct rusage *usage){
+  struct thread *cur = thread_current();
+  struct rusage copy;
+  enum intr_level old_level;
+
+  /* Copy with interrupts off, for a consistent snapshot of the
+     counters that thread_tick() updates. */
+  old_level = intr_disable();
+  if(who == RUSAGE_SELF)
+    copy = cur->usage;
+  else if(who == RUSAGE_CHILDREN)
+    copy = cur->child_usage;
+  else{
+    intr_set_level(old_level);
+    return false;
+  }
+  intr_set_level(old_level);
+
+  put_user_many((uint8_t *)usage, sizeof copy, &copy);
+  return true;
+}
+
+static bool
+our_memstat(struct memstat *stat){
+  struct memstat copy;
+
+  memstat_get(&copy);
+  put_user_many((uint8_t *)stat, sizeof copy, &copy);
+  return true;
+}
+
 static void
 syscall_handler (struct intr_frame *f) 
 {
@@ -421,6 +487,43 @@ syscall_handler (struct intr_frame *f)
       our_close(fd);
       break;
     }
+    case SYS_FUTEX_WAIT:
+    {
+      int *addr;
+      int expected, timeout_ms;
+      get_user_many(f->esp+4, 4, &addr);
+      get_user_many(f->esp+8, 4, &expected);
+      get_user_many(f->esp+12, 4, &timeout_ms);
+      check_futex_addr(addr);
+      f->eax = futex_wait(addr, expected, timeout_ms);
+      break;
+    }
+    case SYS_FUTEX_WAKE:
+    {
+      int *addr;
+      int cnt;
+      get_user_many(f->esp+4, 4, &addr);
+      get_user_many(f->esp+8, 4, &cnt);
+      check_futex_addr(addr);
+      f->eax = futex_wake(addr, cnt);
+      break;
+    }
+    case SYS_GETRUSAGE:
+    {
+      int who;
+      struct rusage *usage;
+      get_user_many(f->esp+4, 4, &who);
+      get_user_many(f->esp+8, 4, &usage);
+      f->eax = our_getrusage(who, usage);
+      break;
+    }
+    case SYS_MEMSTAT:
+    {
+      struct memstat *stat;
+      get_user_many(f->esp+4, 4, &stat);
+      f->eax = our_memstat(stat);
+      break;
+    }
     default:
       break;
   }
@@ -1,16 +1,21 @@
 #include "lib/kernel/list.h"
 #include "vm/frame.h"
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 static struct list frame_table;
 static struct lock frame_lock;
+static struct kmem_cache frame_table_entry_cache;
+static unsigned frame_cnt, frame_cnt_max;  /* Protected by frame_lock. */
 
 void frame_table_init(void) {
   list_init(&frame_table);
   lock_init(&frame_lock);
+  kmem_cache_init(&frame_table_entry_cache, "frame_table_entry",
+                  sizeof(struct frame_table_entry), NULL);
 }
 
 void * frame_alloc(enum palloc_flags flags) {
@@ -25,12 +30,14 @@ void * frame_alloc(enum palloc_flags flags) {
 }
 
 void frame_table_entry_insert(void * page){
-  struct frame_table_entry *frame_table_entry = malloc(sizeof(struct frame_table_entry));
+  struct frame_table_entry *frame_table_entry = kmem_cache_alloc(&frame_table_entry_cache);
   frame_table_entry->kernel_virtual_address = page;
   frame_table_entry->physical_address = vtop(page);
   
   lock_acquire(&frame_lock);
   list_push_front(&frame_table, &frame_table_entry->elem);
+  if (++frame_cnt > frame_cnt_max)
+    frame_cnt_max = frame_cnt;
   lock_release(&frame_lock);
   return;
 }
@@ -45,8 +52,9 @@ void frame_table_entry_free(void * page){
       if(fte->kernel_virtual_address == page){
           lock_acquire(&frame_lock);
           list_remove(&fte->elem);
+          frame_cnt--;
           palloc_free_page(fte->kernel_virtual_address);
-          free(fte);
+          kmem_cache_free(&frame_table_entry_cache, fte);
           lock_release(&frame_lock);
           return;
       }
@@ -54,6 +62,20 @@ void frame_table_entry_free(void * page){
     PANIC("dd");
 }
 
+/* Stores the number of frame table entries in *CNT and the most
+   there have been at once in *MAX.  With interrupts off, reads
+   them without frame_lock, as malloc_get_stats() does. */
+void frame_table_get_stats(unsigned *cnt, unsigned *max){
+  bool locking = intr_get_level() == INTR_ON;
+
+  if (locking)
+    lock_acquire(&frame_lock);
+  *cnt = frame_cnt;
+  *max = frame_cnt_max;
+  if (locking)
+    lock_release(&frame_lock);
+}
+
 void frame_table_entry_evict(void){
   PANIC("??");
   return;
@@ -18,6 +18,7 @@ void * frame_alloc(enum palloc_flags flags);
 void frame_table_entry_insert(void * page);
 void frame_table_entry_free(void * page);
 void frame_table_entry_evict(void);
+void frame_table_get_stats(unsigned *cnt, unsigned *max);
 
 #endif
 
@@ -3,9 +3,15 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 struct lock page_lock;
+static struct kmem_cache spte_cache;
+
+void spt_init(void){
+  kmem_cache_init(&spte_cache, "supplement_page_table_entry",
+                  sizeof(struct supplement_page_table_entry), NULL);
+}
 
 unsigned spt_hash_func(struct hash_elem *hash_elem, void *aux UNUSED){
   struct supplement_page_table_entry *spte = hash_entry(hash_elem, struct supplement_page_table_entry, elem);
@@ -21,7 +27,7 @@ bool spt_less_func(struct hash_elem *a_, struct hash_elem *b_, void *aux UNUSED)
 
 void spt_action_function(struct hash_elem * elem, void *aux UNUSED){
   struct supplement_page_table_entry * spte = hash_entry(elem, struct supplement_page_table_entry, elem);
-  free(spte);
+  kmem_cache_free(&spte_cache, spte);
 }
 
 void supplement_page_table_init(void){
@@ -34,7 +40,7 @@ void supplement_page_table_destroy(void){
 }
 
 bool supplement_page_table_insert(void *upage, int status ,struct file * file, int ofs, int read_bytes, int zero_bytes, bool writeable){
-  struct supplement_page_table_entry *spte = (struct supplement_page_table_entry *) malloc(sizeof(struct supplement_page_table_entry));
+  struct supplement_page_table_entry *spte = kmem_cache_alloc(&spte_cache);
   if (spte == NULL){
     return false;
   }
@@ -53,7 +59,7 @@ bool supplement_page_table_insert(void *upage, int status ,struct file * file, i
   elem = hash_insert(&thread_current()->supplement_page_table, &spte->elem);
   lock_release(&page_lock);
   if(elem != NULL){
-    free(spte);
+    kmem_cache_free(&spte_cache, spte);
     return false;
   }
   return true;
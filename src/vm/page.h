@@ -18,6 +18,7 @@ struct supplement_page_table_entry {
 unsigned spt_hash_func(struct hash_elem *hash_elem, void *aux);
 bool spt_less_func(struct hash_elem *a_, struct hash_elem *b_, void *aux);
 void spt_action_function(struct hash_elem * elem, void *aux);
+void spt_init(void);
 void supplement_page_table_init(void);
 void supplement_page_table_destroy(void);
 bool supplement_page_table_insert(void *upage, int status, struct file * file, int ofs, int read_bytes, int zero_bytes, bool writeable);